@@ -52,6 +52,20 @@ int main(int argc, char** argv)
 
     fprintf(stderr, "This program has %zu bytes\n", sb.count);
 
+    // --- yar_rope
+    // For large outputs, a rope appends into fixed-size chunks, so growing never
+    // copies. Existing buffers can be borrowed without copying them at all.
+    yar_rope rope = {0};
+    yar_rope_append_cstr(&rope, "Header: ");
+    yar_rope_borrow(&rope, sb.items, sb.count);
+    yar_rope_append_cstr(&rope, "\n");
+    // On POSIX, yar_rope_write(&rope, fd) sends it all with writev. Or flatten into one buffer:
+    StringBuilder flat = {0};
+    yar_rope_flatten(&rope, &flat);
+    fprintf(stderr, "Rope of %zu bytes in %zu chunks\n", flat.count, rope.chunks.count);
+    yar_rope_free(&rope);
+    yar_free(&flat);
+
     yar_free(&sb);
     yar_free(&copy);
 }
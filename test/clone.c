@@ -0,0 +1,202 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include <stdlib.h>
+#define YAR_REALLOC failing_realloc
+#include "yar.c"
+
+static int fail_allocations = 0;
+void* failing_realloc(void* p, size_t size)
+{
+    return fail_allocations ? NULL : realloc(p, size);
+}
+
+static int compare_int(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static void twice(void* items, size_t count, void* context)
+{
+    (void)context;
+    for(size_t i = 0; i < count; i++) ((int*)items)[i] *= 2;
+}
+
+typedef yar(int) Ints;
+typedef yar_slice(int) IntSlice;
+
+int main()
+{
+    Ints a = {0};
+    for(int i = 0; i < 100; i++) *yar_append(&a) = i;
+
+    // --- Slices
+    IntSlice slice;
+    yar_slice_from(&slice, &a, 10, 20);
+    assert(slice.items == &a.items[10]);
+    assert(slice.count == 20);
+
+    // Slices of slices
+    IntSlice inner;
+    yar_slice_from(&inner, &slice, 5, 5);
+    assert(inner.items == &a.items[15]);
+    assert(inner.count == 5);
+
+    // Read-only functions accept slices
+    int key = 17;
+    assert(yar_lower_bound(&slice, &key, compare_int) == 7);
+    assert(yar_upper_bound(&inner, &key, compare_int) == 3);
+    Ints dest = {0};
+    yar_union(&dest, &slice, &inner, compare_int);
+    assert(dest.count == 20);
+    yar_intersection(&dest, &a, &inner, compare_int);
+    assert(dest.count == 25);
+    assert(dest.items[20] == 15);
+    yar_append_many(&dest, slice.items, slice.count);
+    assert(dest.count == 45);
+    assert(dest.items[25] == 10);
+    yar_free(&dest);
+
+    // --- Clones
+    Ints b = {0};
+    int* original = a.items;
+    size_t capacity = a.capacity;
+    assert(yar_clone(&b, &a));
+    assert(b.capacity == YAR_SHARED);
+    assert(b.items != original); // Cloning a private array copies it, and leaves it alone
+    assert(b.count == 100);
+    assert(a.items == original);
+    assert(a.capacity == capacity);
+    assert(slice.items == &a.items[10]);
+    yar_free(&b);
+
+    // Once shared, clones are O(1), just sharing the same items
+    assert(yar_share(&a));
+    assert(a.capacity == YAR_SHARED);
+    assert(a.items != original);
+    assert(yar_share(&a));
+    Ints c = {0};
+    Ints d = {0};
+    assert(yar_clone(&b, &a));
+    assert(yar_clone(&c, &b));
+    assert(yar_clone(&d, &a));
+    assert(b.items == a.items);
+    assert(b.count == 100);
+    assert(c.items == a.items);
+    assert(d.items == a.items);
+    const int* shared = a.items;
+
+    // Appending copies
+    *yar_append(&b) = 100;
+    assert(b.items != shared);
+    assert(b.capacity >= 101);
+    assert(b.count == 101);
+    for(int i = 0; i <= 100; i++) assert(b.items[i] == i);
+    assert(a.items == shared);
+    assert(a.count == 100);
+
+    // Inserting copies
+    *(int*)yar_insert(&c, 0, 1) = -1;
+    assert(c.items != shared);
+    assert(c.count == 101);
+    assert(c.items[0] == -1);
+    assert(c.items[1] == 0);
+    assert(shared[0] == 0);
+
+    // Removing copies
+    yar_remove(&d, 0, 10);
+    assert(d.items != shared);
+    assert(d.count == 90);
+    assert(d.items[0] == 10);
+    assert(shared[0] == 0);
+
+    // Unshare copies, and dedup makes a private copy before writing
+    Ints e = {0};
+    assert(yar_clone(&e, &a));
+    assert(yar_unshare(&e));
+    assert(e.items != shared);
+    assert(yar_unshare(&e));
+    assert(e.capacity >= 100);
+    Ints f = {0};
+    assert(yar_clone(&f, &a));
+    assert(yar_dedup(&f, compare_int) == 100);
+    assert(f.items != shared);
+
+    // When the private copy can't be made, nothing is written to the shared items
+    Ints g = {0};
+    assert(yar_clone(&g, &a));
+    a.items[1] = 0; // Test only: a duplicate to remove
+    fail_allocations = 1;
+    assert(yar_dedup(&g, compare_int) == 0);
+    assert(g.items == shared);
+    assert(g.count == 100);
+    int seven = 7;
+    assert(!yar_parallel_fill(NULL, &g, &seven));
+    assert(g.items == shared);
+    fail_allocations = 0;
+    for(int i = 0; i < 100; i++) assert(a.items[i] == (i == 1 ? 0 : i));
+    assert(yar_dedup(&g, compare_int) == 99);
+    assert(yar_parallel_fill(NULL, &g, &seven));
+    assert(g.items[98] == 7);
+    a.items[1] = 1;
+
+    // Parallel transforms make a private copy before writing too
+    yar_free(&g);
+    assert(yar_clone(&g, &a));
+    fail_allocations = 1;
+    assert(!yar_parallel_for(NULL, &g, twice, NULL));
+    assert(g.items == shared);
+    fail_allocations = 0;
+    assert(yar_parallel_for(NULL, &g, twice, NULL));
+    assert(g.items != shared);
+    assert(g.items[3] == 6);
+    assert(shared[3] == 3);
+    yar_free(&g);
+
+    // Freeing a clone leaves the others
+    yar_free(&b);
+    yar_free(&c);
+    yar_free(&d);
+    yar_free(&e);
+    yar_free(&f);
+    for(int i = 0; i < 100; i++) assert(a.items[i] == i);
+
+    // The last reference can still be changed, and freed
+    yar_reset(&a);
+    *yar_append(&a) = 5;
+    assert(a.count == 1);
+    assert(a.capacity > 0);
+    yar_free(&a);
+
+    // Cloning into a non-empty array releases its items, and cloning an array into itself is a no-op
+    for(int i = 0; i < 10; i++) *yar_append(&a) = i;
+    assert(yar_share(&a));
+    *yar_append(&b) = 9;
+    assert(yar_clone(&b, &a));
+    assert(b.items == a.items);
+    assert(b.count == 10);
+    assert(yar_clone(&a, &a));
+    assert(a.items == b.items);
+    assert(a.count == 10);
+    yar_free(&b);
+    yar_free(&a); // ASan would report the items leaking if either clone took an extra reference
+
+    // Arrays with a capacity of 0 and borrowed items, like rope chunks, aren't shared
+    int borrowed[3] = {1, 2, 3};
+    Ints view = {borrowed, 3, 0};
+    assert(yar_unshare(&view));
+    assert(view.items == borrowed);
+    assert(yar_clone(&b, &view));
+    assert(b.items != borrowed);
+    assert(b.capacity == YAR_SHARED);
+    assert(b.items[2] == 3);
+    yar_free(&b);
+
+    // Cloning an empty array
+    Ints empty = {0};
+    assert(yar_clone(&b, &empty));
+    assert(b.items == NULL && b.count == 0);
+    *yar_append(&b) = 1;
+    yar_free(&b);
+}
@@ -0,0 +1,108 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include <stdlib.h>
+#include "yar.c"
+
+typedef yar_gap(char) GapText;
+
+static void check(GapText* text, const char* expected)
+{
+    size_t len = strlen(expected);
+    assert(text->count == len);
+    for(size_t i = 0; i < len; i++) {
+        assert(*yar_gap_at(text, i) == expected[i]);
+    }
+    assert(memcmp(yar_gap_before(text), expected, text->cursor) == 0);
+    assert(memcmp(yar_gap_after(text), expected + text->cursor, len - text->cursor) == 0);
+}
+
+int main()
+{
+    GapText text = {0};
+    char* x;
+
+    x = yar_gap_insert(&text, 0, 5);
+    assert(text.count == 5);
+    assert(text.cursor == 5);
+    assert(text.capacity >= 5);
+    for(int i = 0; i < 5; i++) assert(x[i] == 0);
+    memcpy(x, "hello", 5);
+    check(&text, "hello");
+
+    // Insert at the beginning
+    x = yar_gap_insert(&text, 0, 2);
+    assert(text.cursor == 2);
+    memcpy(x, ">>", 2);
+    check(&text, ">>hello");
+
+    // Insert in the middle, and at the end
+    memcpy(yar_gap_insert(&text, 4, 1), "-", 1);
+    check(&text, ">>he-llo");
+    memcpy(yar_gap_insert(&text, text.count, 6), " world", 6);
+    check(&text, ">>he-llo world");
+    assert(text.cursor == text.count);
+
+    // Remove
+    yar_gap_remove(&text, 0, 2);
+    assert(text.cursor == 0);
+    check(&text, "he-llo world");
+    yar_gap_remove(&text, 2, 1);
+    assert(text.cursor == 2);
+    check(&text, "hello world");
+    yar_gap_remove(&text, 5, 100);
+    assert(text.cursor == 5);
+    check(&text, "hello");
+
+    // Move the cursor around
+    yar_gap_move(&text, 1);
+    assert(text.cursor == 1);
+    check(&text, "hello");
+    yar_gap_move(&text, 4);
+    assert(text.cursor == 4);
+    check(&text, "hello");
+    yar_gap_move(&text, 100);
+    assert(text.cursor == 5);
+    check(&text, "hello");
+
+    // Growing keeps the items after the gap
+    yar_gap_move(&text, 2);
+    for(int i = 0; i < 1000; i++) {
+        *(char*)yar_gap_insert(&text, text.cursor, 1) = '.';
+    }
+    assert(text.count == 1005);
+    assert(text.cursor == 1002);
+    assert(memcmp(yar_gap_after(&text), "llo", 3) == 0);
+
+    // Flatten
+    char* flat = yar_gap_flatten(&text);
+    assert(flat == text.items);
+    assert(text.cursor == text.count);
+    assert(memcmp(flat, "he", 2) == 0);
+    for(int i = 2; i < 1002; i++) assert(flat[i] == '.');
+    assert(memcmp(flat + 1002, "llo", 3) == 0);
+    yar_gap_free(&text);
+
+    // Random edits against a plain yar array
+    yar(char) reference = {0};
+    srand(1234);
+    for(int round = 0; round < 5000; round++) {
+        size_t index = reference.count ? (size_t)rand() % (reference.count + 1) : 0;
+        size_t num = (size_t)rand() % 8;
+        if (rand() % 3) {
+            char* a = yar_insert(&reference, index, num);
+            char* b = yar_gap_insert(&text, index, num);
+            for(size_t i = 0; i < num; i++) a[i] = b[i] = 'a' + rand() % 26;
+        } else {
+            if (num > reference.count - index) num = reference.count - index;
+            yar_remove(&reference, index, num);
+            yar_gap_remove(&text, index, num);
+        }
+        assert(text.count == reference.count);
+        for(size_t i = 0; i < reference.count; i++) {
+            assert(*yar_gap_at(&text, i) == reference.items[i]);
+        }
+    }
+
+    yar_free(&reference);
+    yar_gap_free(&text);
+}
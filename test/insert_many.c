@@ -0,0 +1,80 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include <stdlib.h>
+#include "yar.c"
+
+int main()
+{
+    yar(int) ints = {0};
+    int* x;
+
+    // Nothing to insert
+    x = yar_insert_many_at(&ints, NULL, 0);
+    assert(x == NULL);
+    assert(ints.count == 0);
+
+    // Into an empty array
+    int a[] = { 1, 2, 3 };
+    yar_insertion first[] = { { 0, 3, a } };
+    x = yar_insert_many_at(&ints, first, 1);
+    assert(x == ints.items);
+    assert(ints.count == 3);
+    assert(ints.items[0] == 1 && ints.items[1] == 2 && ints.items[2] == 3);
+
+    // At the beginning, middle, and end. Same index keeps the given order, NULL data is zeroed.
+    int b[] = { 10, 11 };
+    int c[] = { 20 };
+    int d[] = { 30, 31, 32 };
+    yar_insertion many[] = {
+        { 0, 2, b },
+        { 1, 1, c },
+        { 1, 2, NULL },
+        { 3, 3, d },
+        { 100, 1, c }, // Past the end is the same as the end
+    };
+    x = yar_insert_many_at(&ints, many, 5);
+    assert(x == ints.items);
+    int expected[] = { 10, 11, 1, 20, 0, 0, 2, 3, 30, 31, 32, 20 };
+    assert(ints.count == 12);
+    for(int i = 0; i < 12; i++) assert(ints.items[i] == expected[i]);
+    yar_free(&ints);
+
+    // Compare against one yar_insert at a time, from the back so the indexes stay valid
+    yar(int) reference = {0};
+    srand(42);
+    for(int round = 0; round < 200; round++) {
+        yar_reset(&ints);
+        yar_reset(&reference);
+        size_t n = (size_t)rand() % 100;
+        for(size_t i = 0; i < n; i++) {
+            *yar_append(&ints) = (int)i;
+            *yar_append(&reference) = (int)i;
+        }
+
+        yar(yar_insertion) insertions = {0};
+        int data[16];
+        for(int i = 0; i < 16; i++) data[i] = 1000 + round * 16 + i;
+        size_t index = 0;
+        while(index <= n && insertions.count < 20) {
+            index += (size_t)rand() % 10;
+            if (index > n) break;
+            yar_insertion* insertion = yar_append(&insertions);
+            insertion->index = index;
+            insertion->count = (size_t)rand() % 5;
+            insertion->data = (rand() % 4) ? &data[rand() % 12] : NULL;
+        }
+        for(size_t i = insertions.count; i-- > 0;) {
+            yar_insertion* insertion = &insertions.items[i];
+            int* p = yar_insert(&reference, insertion->index, insertion->count);
+            if (insertion->data && insertion->count) memcpy(p, insertion->data, insertion->count * sizeof(int));
+        }
+        yar_insert_many_at(&ints, insertions.items, insertions.count);
+
+        assert(ints.count == reference.count);
+        assert(ints.count == 0 || memcmp(ints.items, reference.items, ints.count * sizeof(int)) == 0);
+        yar_free(&insertions);
+    }
+
+    yar_free(&reference);
+    yar_free(&ints);
+}
@@ -0,0 +1,145 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include <stdlib.h>
+#define YAR_REALLOC failing_realloc
+#include "yar.c"
+
+static int fail_allocations = 0;
+void* failing_realloc(void* p, size_t size)
+{
+    return fail_allocations ? NULL : realloc(p, size);
+}
+
+typedef yar(uint64_t) Values;
+
+static void check(yar_packed* packed, Values* values)
+{
+    assert(packed->count == values->count);
+    for(size_t i = 0; i < values->count; i++) {
+        assert(yar_packed_get(packed, i) == values->items[i]);
+    }
+
+    uint64_t block[YAR_PACKED_BLOCK];
+    size_t total = 0;
+    for(size_t b = 0; b < yar_packed_block_count(packed); b++) {
+        size_t n = yar_packed_decode_block(packed, b, block);
+        assert(n > 0 && n <= YAR_PACKED_BLOCK);
+        assert(memcmp(block, &values->items[total], n * sizeof(uint64_t)) == 0);
+        total += n;
+    }
+    assert(total == values->count);
+
+    Values out = {0};
+    *yar_append(&out) = 42;
+    uint64_t* begin = yar_packed_to(packed, &out);
+    assert(begin == &out.items[1]);
+    assert(out.count == values->count + 1);
+    assert(out.items[0] == 42);
+    assert(memcmp(begin, values->items, values->count * sizeof(uint64_t)) == 0);
+    yar_free(&out);
+}
+
+int main()
+{
+    yar_packed packed = {0};
+    Values values = {0};
+
+    // Empty
+    assert(packed.count == 0);
+    assert(yar_packed_block_count(&packed) == 0);
+
+    // Sizes around the block boundaries
+    size_t sizes[] = { 1, 127, 128, 129, 255, 256, 1000 };
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        for(size_t i = 0; i < sizes[s]; i++) {
+            *yar_append(&values) = 1000 + i * 3 + (i % 5);
+            assert(yar_packed_append(&packed, values.items[i]));
+        }
+        check(&packed, &values);
+        yar_packed_free(&packed);
+        yar_reset(&values);
+    }
+
+    // Timestamps with a fixed step pack to nothing but block headers
+    for(uint64_t i = 0; i < 100000; i++) {
+        *yar_append(&values) = 1700000000000ull + i * 1000;
+    }
+    assert(yar_packed_from(&packed, &values));
+    check(&packed, &values);
+    assert(packed.words.count == 0);
+    yar_packed_free(&packed);
+    yar_reset(&values);
+
+    // Jittery timestamps still pack to a few bits each
+    srand(1);
+    uint64_t t = 1700000000000ull;
+    for(int i = 0; i < 100000; i++) {
+        t += 900 + rand() % 200;
+        *yar_append(&values) = t;
+    }
+    assert(yar_packed_from(&packed, &values));
+    check(&packed, &values);
+    size_t packed_size = packed.words.count * sizeof(uint64_t) + packed.blocks.count * sizeof(yar_packed_block);
+    assert(packed_size * 3 < values.count * sizeof(uint64_t));
+    yar_packed_free(&packed);
+    yar_reset(&values);
+
+    // Unsorted and extreme values need the full 64 bits, but still work
+    for(int i = 0; i < 1000; i++) {
+        uint64_t x = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+        *yar_append(&values) = (i % 7 == 0) ? UINT64_MAX : (i % 11 == 0) ? 0 : x;
+    }
+    assert(yar_packed_from(&packed, &values));
+    check(&packed, &values);
+    yar_packed_free(&packed);
+    yar_reset(&values);
+
+    // Every bit width
+    for(int bits = 0; bits <= 64; bits++) {
+        uint64_t v = 0;
+        for(int i = 0; i < 300; i++) {
+            uint64_t mask = bits == 0 ? 0 : ~(uint64_t)0 >> (64 - bits);
+            uint64_t x = ((uint64_t)rand() << 40) ^ ((uint64_t)rand() << 20) ^ (uint64_t)rand();
+            uint64_t step = bits == 0 ? 7 : (i % 3 == 0) ? mask : (i % 3 == 1) ? 0 : x & mask;
+            v += step;
+            *yar_append(&values) = v;
+        }
+        assert(yar_packed_from(&packed, &values));
+        check(&packed, &values);
+        yar_packed_free(&packed);
+        yar_reset(&values);
+    }
+
+    // Allocation failure leaves the values so far intact, and appending can carry on afterwards
+    for(int i = 0; i < 1000; i++) {
+        *yar_append(&values) = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+    }
+    assert(yar_packed_from(&packed, &values));
+    (void)yar_reserve(&values, 1000 * YAR_PACKED_BLOCK); // So only the packed array fails
+    fail_allocations = 1;
+    int failed = 0;
+    for(int round = 0; round < 1000 && !failed; round++) {
+        uint64_t more[YAR_PACKED_BLOCK];
+        for(int i = 0; i < YAR_PACKED_BLOCK; i++) more[i] = ((uint64_t)rand() << 32) ^ (uint64_t)rand();
+        size_t before = packed.count;
+        if (yar_packed_append_many(&packed, more, YAR_PACKED_BLOCK)) {
+            yar_append_many(&values, more, YAR_PACKED_BLOCK);
+        } else {
+            failed = 1;
+            // The values before the failing block are kept
+            assert(packed.count >= before && packed.count < before + YAR_PACKED_BLOCK);
+            yar_append_many(&values, more, packed.count - before);
+        }
+    }
+    fail_allocations = 0;
+    assert(failed);
+    check(&packed, &values);
+    for(int i = 0; i < 1000; i++) {
+        *yar_append(&values) = (uint64_t)i;
+        assert(yar_packed_append(&packed, (uint64_t)i));
+    }
+    check(&packed, &values);
+    yar_packed_free(&packed);
+
+    yar_free(&values);
+}
@@ -0,0 +1,92 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#define YAR_THREADS
+#define YAR_PARALLEL_MIN 4096
+#define YAR_PARALLEL_CHUNK 1000 // Not a multiple of the item size
+#include "yar.c"
+
+typedef struct {
+    double x, y, z;
+} Vec3;
+
+static void scale(void* items, size_t count, void* context)
+{
+    Vec3* v = items;
+    double factor = *(double*)context;
+    for(size_t i = 0; i < count; i++) {
+        v[i].x *= factor;
+        v[i].y *= factor;
+        v[i].z *= factor;
+    }
+}
+
+static void count_calls(void* items, size_t count, void* context)
+{
+    (void)items;
+    (void)count;
+    __atomic_fetch_add((size_t*)context, 1, __ATOMIC_RELAXED);
+}
+
+static void run(yar_pool* pool)
+{
+    yar(Vec3) vecs = {0};
+    Vec3 one = { 1, 2, 3 };
+
+    // Reserve zeroes the new space
+    Vec3* x = yar_parallel_reserve(pool, &vecs, 100000);
+    assert(x == vecs.items);
+    assert(vecs.count == 0);
+    assert(vecs.capacity >= 100000);
+    for(size_t i = 0; i < 100000; i++) assert(x[i].x == 0 && x[i].y == 0 && x[i].z == 0);
+    vecs.count = 100000;
+
+    yar_parallel_fill(pool, &vecs, &one);
+    for(size_t i = 0; i < vecs.count; i++) assert(vecs.items[i].x == 1 && vecs.items[i].y == 2 && vecs.items[i].z == 3);
+
+    double factor = 2;
+    yar_parallel_for(pool, &vecs, scale, &factor);
+    for(size_t i = 0; i < vecs.count; i++) assert(vecs.items[i].x == 2 && vecs.items[i].y == 4 && vecs.items[i].z == 6);
+
+    // Small arrays run in one call on this thread
+    yar(Vec3) small = {0};
+    yar_append_many(&small, vecs.items, 10);
+    size_t calls = 0;
+    yar_parallel_for(pool, &small, count_calls, &calls);
+    assert(calls == 1);
+    calls = 0;
+    yar_parallel_for(pool, &vecs, count_calls, &calls);
+    assert(calls == (pool ? (vecs.count + 40) / 41 : 1));
+
+    // Copy and append
+    yar(Vec3) copy = {0};
+    for(size_t i = 0; i < vecs.count; i++) vecs.items[i].x = (double)i;
+    *yar_append(&copy) = one;
+    yar_parallel_copy(pool, &copy, &vecs);
+    assert(copy.count == vecs.count);
+    assert(memcmp(copy.items, vecs.items, vecs.count * sizeof(Vec3)) == 0);
+
+    Vec3* appended = yar_parallel_append_many(pool, &copy, vecs.items, 50000);
+    assert(appended == &copy.items[100000]);
+    assert(copy.count == 150000);
+    for(size_t i = 0; i < copy.count; i++) assert(copy.items[i].x == (double)(i % 100000));
+
+    yar_free(&vecs);
+    yar_free(&small);
+    yar_free(&copy);
+}
+
+int main()
+{
+    // With no pool, everything is serial
+    run(NULL);
+
+    yar_pool* pool = yar_pool_create(3);
+    assert(pool != NULL);
+    for(int i = 0; i < 20; i++) run(pool);
+    yar_pool_destroy(pool);
+
+    pool = yar_pool_create(0);
+    assert(pool != NULL);
+    run(pool);
+    yar_pool_destroy(pool);
+}
@@ -0,0 +1,74 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include "yar.c"
+
+int main()
+{
+    yar_reader readers[2] = {0};
+    yar_publisher publisher = {0};
+    publisher.readers = readers;
+    publisher.reader_count = 2;
+    yar(int) ints = {0};
+    yar_snapshot snapshot;
+
+    // Each reader has a cache line to itself
+    assert(sizeof(yar_reader) == 64);
+    assert((uintptr_t)&readers[0] % 64 == 0);
+    assert((uintptr_t)&readers[1] % 64 == 0);
+
+    // Nothing published yet
+    snapshot = yar_read_begin(&publisher, &readers[0]);
+    assert(snapshot.items == NULL);
+    assert(snapshot.count == 0);
+    yar_read_end(&readers[0]);
+
+    for(int i = 0; i < 10; i++) *yar_published_append(&publisher, &ints) = i;
+    assert(ints.count == 10);
+    assert(yar_publish(&publisher, &ints));
+
+    snapshot = yar_read_begin(&publisher, &readers[0]);
+    assert(snapshot.items == ints.items);
+    assert(snapshot.count == 10);
+    const int* items = snapshot.items;
+    const int* old_items = items;
+
+    // Appending past the capacity moves the buffer, but the reader's snapshot stays valid
+    int data[100];
+    for(int i = 0; i < 100; i++) data[i] = 10 + i;
+    int* appended = yar_published_append_many(&publisher, &ints, data, 100);
+    assert(appended == &ints.items[10]);
+    assert(ints.items != old_items);
+    assert(ints.count == 110);
+    assert(yar_publish(&publisher, &ints));
+    for(int i = 0; i < 10; i++) assert(items[i] == i);
+
+    // The old buffer and snapshot can't be freed while the reader is still reading
+    yar_publisher_reclaim(&publisher);
+    assert(publisher.retired.count == 2);
+
+    // A new reader sees the new snapshot
+    snapshot = yar_read_begin(&publisher, &readers[1]);
+    assert(snapshot.items == ints.items);
+    assert(snapshot.count == 110);
+    items = snapshot.items;
+    for(int i = 0; i < 110; i++) assert(items[i] == i);
+
+    yar_read_end(&readers[0]);
+    yar_publisher_reclaim(&publisher);
+    assert(publisher.retired.count == 0);
+
+    // Buffers retired by reserve wait for the next publish, as readers can still see them until then
+    int* space = yar_published_reserve(&publisher, &ints, 1000);
+    assert(space == &ints.items[110]);
+    assert(space[0] == 0);
+    assert(ints.count == 110);
+    yar_read_end(&readers[1]);
+    yar_publisher_reclaim(&publisher);
+    assert(publisher.retired.count == 1);
+    assert(yar_publish(&publisher, &ints));
+    assert(publisher.retired.count == 0);
+
+    yar_publisher_free(&publisher);
+    assert(publisher.current == NULL);
+    yar_free(&ints);
+}
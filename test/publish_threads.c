@@ -0,0 +1,56 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include <pthread.h>
+#include "yar.c"
+
+// One writer appends and publishes while readers scan every snapshot.
+// Most useful when built with -fsanitize=thread or -fsanitize=address.
+
+#define NUM_READERS 4
+#define NUM_ITEMS 200000
+
+static yar_reader readers[NUM_READERS];
+static yar_publisher publisher;
+static int done;
+
+static void* reader_thread(void* arg)
+{
+    yar_reader* reader = arg;
+    size_t last_count = 0;
+    while(!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        yar_snapshot snapshot = yar_read_begin(&publisher, reader);
+        const long* items = snapshot.items;
+        // Snapshots only ever grow, and always hold what was appended
+        assert(snapshot.count >= last_count);
+        for(size_t i = 0; i < snapshot.count; i++) assert(items[i] == (long)i);
+        last_count = snapshot.count;
+        yar_read_end(reader);
+    }
+    return NULL;
+}
+
+int main()
+{
+    publisher.readers = readers;
+    publisher.reader_count = NUM_READERS;
+    yar(long) items = {0};
+
+    pthread_t threads[NUM_READERS];
+    for(int i = 0; i < NUM_READERS; i++) {
+        assert(pthread_create(&threads[i], NULL, reader_thread, &readers[i]) == 0);
+    }
+    for(long i = 0; i < NUM_ITEMS; i++) {
+        *yar_published_append(&publisher, &items) = i;
+        if (i % 37 == 0) assert(yar_publish(&publisher, &items));
+    }
+    assert(yar_publish(&publisher, &items));
+    __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+    for(int i = 0; i < NUM_READERS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    yar_publisher_reclaim(&publisher);
+    assert(publisher.retired.count == 0);
+    yar_publisher_free(&publisher);
+    yar_free(&items);
+}
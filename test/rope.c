@@ -0,0 +1,125 @@
+#undef NDEBUG // Force-enable asserts
+#define _POSIX_C_SOURCE 200809L // fileno
+#include <assert.h>
+#include <stdlib.h>
+#define YAR_ROPE_CHUNK 16
+#define YAR_REALLOC failing_realloc
+#include "yar.c"
+#include <stdio.h>
+#include <unistd.h>
+
+static int fail_allocations = 0;
+void* failing_realloc(void* p, size_t size)
+{
+    return fail_allocations ? NULL : realloc(p, size);
+}
+
+int main()
+{
+    yar_rope rope = {0};
+    yar(char) flat = {0};
+
+    assert(yar_rope_append_cstr(&rope, "Hello"));
+    assert(rope.count == 5);
+    assert(rope.chunks.count == 1);
+
+    // Spans several chunks
+    assert(yar_rope_append_cstr(&rope, ", this is a longer string"));
+    assert(rope.count == 30);
+    assert(rope.chunks.count == 2);
+    char* first = rope.chunks.items[0].items;
+
+    // Borrowed data is not copied
+    static const char borrowed[] = " [borrowed] ";
+    assert(yar_rope_borrow(&rope, borrowed, strlen(borrowed)));
+    assert(rope.chunks.count == 3);
+    assert(rope.chunks.items[2].items == borrowed);
+    assert(rope.chunks.items[2].capacity == 0);
+
+    // Appending after a borrowed chunk carries on in the spare space of the last allocated chunk
+    assert(rope.chunks.items[1].count == 14);
+    assert(yar_rope_append_cstr(&rope, "end"));
+    assert(rope.chunks.count == 5);
+    assert(rope.chunks.items[3].items == rope.chunks.items[1].items + 14);
+    assert(rope.chunks.items[3].count == 2);
+    assert(rope.chunks.items[3].capacity == 0);
+    assert(rope.chunks.items[4].count == 1);
+    assert(rope.chunks.items[4].capacity == YAR_ROPE_CHUNK);
+    assert(rope.count == 30 + strlen(borrowed) + 3);
+
+    // Small pieces between borrowed buffers share allocated chunks
+    yar_rope pieces = {0};
+    for(int i = 0; i < 8; i++) {
+        assert(yar_rope_append_cstr(&pieces, "ab"));
+        assert(yar_rope_borrow(&pieces, borrowed, strlen(borrowed)));
+    }
+    size_t allocated = 0;
+    for(size_t i = 0; i < pieces.chunks.count; i++) allocated += pieces.chunks.items[i].capacity != 0;
+    assert(allocated == 1);
+    yar_rope_free(&pieces);
+
+    // Chunks never move
+    for(int i = 0; i < 100; i++) assert(yar_rope_append_cstr(&rope, "0123456789"));
+    assert(rope.chunks.items[0].items == first);
+
+    *yar_append(&flat) = '>';
+    char* begin = yar_rope_flatten(&rope, &flat);
+    assert(begin == &flat.items[1]);
+    assert(flat.count == rope.count + 1);
+    *yar_append(&flat) = '\0';
+    assert(strncmp(flat.items, ">Hello, this is a longer string [borrowed] end0123456789", 56) == 0);
+    for(int i = 0; i < 100; i++) assert(memcmp(&flat.items[56 + i * 10 - 10], "0123456789", 10) == 0);
+
+    // Write it out through a pipe, and read it back
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(yar_rope_write(&rope, fds[1]) == 0);
+    close(fds[1]);
+    yar(char) read_back = {0};
+    ssize_t n;
+    while((n = read(fds[0], yar_reserve(&read_back, 4096), 4096)) > 0) read_back.count += n;
+    close(fds[0]);
+    assert(read_back.count == rope.count);
+    assert(memcmp(read_back.items, flat.items + 1, rope.count) == 0);
+
+    yar_rope_free(&rope);
+    assert(rope.count == 0);
+    assert(rope.chunks.count == 0);
+
+    // More chunks than one writev call takes
+    for(int i = 0; i < 3000; i++) {
+        assert(yar_rope_borrow(&rope, borrowed, strlen(borrowed)));
+        assert(yar_rope_append_cstr(&rope, "ab"));
+    }
+    assert(rope.chunks.count == 6000);
+    FILE* file = tmpfile();
+    assert(file != NULL);
+    assert(yar_rope_write(&rope, fileno(file)) == 0);
+    rewind(file);
+    yar_reset(&read_back);
+    size_t got;
+    while((got = fread(yar_reserve(&read_back, 4096), 1, 4096, file)) > 0) read_back.count += got;
+    fclose(file);
+    assert(read_back.count == rope.count);
+    for(int i = 0; i < 3000; i++) assert(memcmp(&read_back.items[i * 14], " [borrowed] ab", 14) == 0);
+    yar_rope_free(&rope);
+
+    // Allocation failure keeps what is already there
+    for(int i = 0; i < YAR_MIN_CAP; i++) assert(yar_rope_append(&rope, "0123456789abcdef", 16));
+    assert(rope.chunks.count == rope.chunks.capacity);
+    fail_allocations = 1;
+    assert(!yar_rope_append_cstr(&rope, "x"));
+    assert(!yar_rope_borrow(&rope, borrowed, strlen(borrowed)));
+    fail_allocations = 0;
+    assert(rope.chunks.count == YAR_MIN_CAP);
+    assert(rope.count == YAR_MIN_CAP * 16);
+    yar_reset(&flat);
+    yar_rope_flatten(&rope, &flat);
+    for(int i = 0; i < YAR_MIN_CAP; i++) assert(memcmp(&flat.items[i * 16], "0123456789abcdef", 16) == 0);
+    assert(yar_rope_append_cstr(&rope, "x"));
+    assert(rope.count == YAR_MIN_CAP * 16 + 1);
+    yar_rope_free(&rope);
+
+    yar_free(&flat);
+    yar_free(&read_back);
+}
@@ -0,0 +1,222 @@
+#undef NDEBUG // Force-enable asserts
+#include <assert.h>
+#include "yar.c"
+
+static int compare_int(const void* a, const void* b)
+{
+    int x = *(const int*)a;
+    int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static size_t comparisons = 0;
+static int counting_compare_int(const void* a, const void* b)
+{
+    comparisons++;
+    return compare_int(a, b);
+}
+
+typedef struct {
+    int key;
+    int order;
+} Pair;
+
+static int compare_pair(const void* a, const void* b)
+{
+    return compare_int(&((const Pair*)a)->key, &((const Pair*)b)->key);
+}
+
+typedef yar(int) Ints;
+
+static Ints make(int* data, size_t num)
+{
+    Ints result = {0};
+    yar_append_many(&result, data, num);
+    return result;
+}
+
+static void check(Ints* arr, const int* expected, size_t num)
+{
+    assert(arr->count == num);
+    for(size_t i = 0; i < num; i++) {
+        assert(arr->items[i] == expected[i]);
+    }
+}
+
+int main()
+{
+    // Bounds
+    int data[] = { 1, 3, 3, 3, 5, 7, 9 };
+    Ints arr = make(data, 7);
+    int key;
+    key = 0; assert(yar_lower_bound(&arr, &key, compare_int) == 0);
+    key = 0; assert(yar_upper_bound(&arr, &key, compare_int) == 0);
+    key = 1; assert(yar_lower_bound(&arr, &key, compare_int) == 0);
+    key = 1; assert(yar_upper_bound(&arr, &key, compare_int) == 1);
+    key = 3; assert(yar_lower_bound(&arr, &key, compare_int) == 1);
+    key = 3; assert(yar_upper_bound(&arr, &key, compare_int) == 4);
+    key = 4; assert(yar_lower_bound(&arr, &key, compare_int) == 4);
+    key = 4; assert(yar_upper_bound(&arr, &key, compare_int) == 4);
+    key = 9; assert(yar_lower_bound(&arr, &key, compare_int) == 6);
+    key = 9; assert(yar_upper_bound(&arr, &key, compare_int) == 7);
+    key = 10; assert(yar_lower_bound(&arr, &key, compare_int) == 7);
+    yar_free(&arr);
+
+    Ints empty = {0};
+    key = 5;
+    assert(yar_lower_bound(&empty, &key, compare_int) == 0);
+    assert(yar_upper_bound(&empty, &key, compare_int) == 0);
+
+    // Bounds agree with a linear search for every size
+    for(int n = 0; n < 40; n++) {
+        for(int i = 0; i < n; i++) *yar_append(&arr) = i / 2;
+        for(key = -1; key <= n / 2 + 1; key++) {
+            size_t lower = 0, upper = 0;
+            while(lower < arr.count && arr.items[lower] < key) lower++;
+            while(upper < arr.count && arr.items[upper] <= key) upper++;
+            assert(yar_lower_bound(&arr, &key, compare_int) == lower);
+            assert(yar_upper_bound(&arr, &key, compare_int) == upper);
+        }
+        yar_reset(&arr);
+    }
+    yar_free(&arr);
+
+    // Sorted insert
+    int values[] = { 5, 1, 9, 3, 3, 7, 0, 9 };
+    for(int i = 0; i < 8; i++) {
+        int* x = yar_sorted_insert(&arr, &values[i], compare_int);
+        assert(*x == values[i]);
+    }
+    int sorted[] = { 0, 1, 3, 3, 5, 7, 9, 9 };
+    check(&arr, sorted, 8);
+
+    // Equal items keep their insertion order
+    yar(Pair) pairs = {0};
+    Pair p;
+    p.key = 2; p.order = 0; yar_sorted_insert(&pairs, &p, compare_pair);
+    p.key = 1; p.order = 1; yar_sorted_insert(&pairs, &p, compare_pair);
+    p.key = 2; p.order = 2; yar_sorted_insert(&pairs, &p, compare_pair);
+    p.key = 2; p.order = 3; yar_sorted_insert(&pairs, &p, compare_pair);
+    assert(pairs.count == 4);
+    assert(pairs.items[0].order == 1);
+    assert(pairs.items[1].order == 0);
+    assert(pairs.items[2].order == 2);
+    assert(pairs.items[3].order == 3);
+    yar_free(&pairs);
+
+    // Dedup
+    assert(yar_dedup(&arr, compare_int) == 6);
+    int deduped[] = { 0, 1, 3, 5, 7, 9 };
+    check(&arr, deduped, 6);
+    assert(yar_dedup(&arr, compare_int) == 6);
+    assert(yar_dedup(&empty, compare_int) == 0);
+    yar_free(&arr);
+
+    // Set operations
+    int a_data[] = { 1, 2, 2, 4, 6, 8, 10 };
+    int b_data[] = { 2, 3, 4, 5, 10, 11 };
+    Ints a = make(a_data, 7);
+    Ints b = make(b_data, 6);
+    Ints dest = {0};
+
+    int merged[] = { 1, 2, 2, 2, 3, 4, 4, 5, 6, 8, 10, 10, 11 };
+    yar_merge(&dest, &a, &b, compare_int);
+    check(&dest, merged, 13);
+    yar_reset(&dest);
+
+    int unioned[] = { 1, 2, 2, 3, 4, 5, 6, 8, 10, 11 };
+    yar_union(&dest, &a, &b, compare_int);
+    check(&dest, unioned, 10);
+    yar_reset(&dest);
+
+    int intersected[] = { 2, 4, 10 };
+    yar_intersection(&dest, &a, &b, compare_int);
+    check(&dest, intersected, 3);
+    yar_reset(&dest);
+
+    int differenced[] = { 1, 2, 6, 8 };
+    yar_difference(&dest, &a, &b, compare_int);
+    check(&dest, differenced, 4);
+
+    // Results are appended to the existing contents of dest
+    int* begin = yar_intersection(&dest, &a, &b, compare_int);
+    assert(begin == &dest.items[4]);
+    int appended[] = { 1, 2, 6, 8, 2, 4, 10 };
+    check(&dest, appended, 7);
+    yar_reset(&dest);
+
+    // Empty inputs
+    yar_union(&dest, &a, &empty, compare_int);
+    check(&dest, a_data, 7);
+    yar_reset(&dest);
+    yar_union(&dest, &empty, &b, compare_int);
+    check(&dest, b_data, 6);
+    yar_reset(&dest);
+    yar_intersection(&dest, &a, &empty, compare_int);
+    assert(dest.count == 0);
+    yar_difference(&dest, &a, &empty, compare_int);
+    check(&dest, a_data, 7);
+    yar_reset(&dest);
+    yar_free(&a);
+    yar_free(&b);
+
+    // Skewed sizes, where galloping skips long runs
+    for(int i = 0; i < 10000; i++) *yar_append(&a) = i * 2;
+    int few[] = { -1, 100, 101, 5000, 19998, 30000 };
+    b = make(few, 6);
+
+    yar_intersection(&dest, &a, &b, compare_int);
+    int few_common[] = { 100, 5000, 19998 };
+    check(&dest, few_common, 3);
+    yar_reset(&dest);
+
+    yar_merge(&dest, &a, &b, compare_int);
+    assert(dest.count == 10006);
+    for(size_t i = 1; i < dest.count; i++) assert(dest.items[i - 1] <= dest.items[i]);
+    yar_reset(&dest);
+
+    yar_union(&dest, &b, &a, compare_int);
+    assert(dest.count == 10003);
+    for(size_t i = 1; i < dest.count; i++) assert(dest.items[i - 1] < dest.items[i]);
+    yar_reset(&dest);
+
+    yar_difference(&dest, &a, &b, compare_int);
+    assert(dest.count == 9997);
+    for(size_t i = 0; i < dest.count; i++) {
+        assert(dest.items[i] != 100 && dest.items[i] != 5000 && dest.items[i] != 19998);
+    }
+
+    yar_free(&a);
+    yar_free(&b);
+    yar_reset(&dest);
+
+    // Interleaved inputs cost about one comparison per item
+    for(int i = 0; i < 100000; i++) {
+        *yar_append(&a) = i * 2;
+        *yar_append(&b) = i * 2 + 1;
+    }
+    comparisons = 0;
+    yar_merge(&dest, &a, &b, counting_compare_int);
+    assert(dest.count == 200000);
+    for(size_t i = 0; i < dest.count; i++) assert(dest.items[i] == (int)i);
+    assert(comparisons < 200000);
+    yar_reset(&dest);
+    comparisons = 0;
+    yar_union(&dest, &a, &b, counting_compare_int);
+    assert(dest.count == 200000);
+    assert(comparisons < 200000);
+    yar_reset(&dest);
+
+    // Skewed inputs gallop, and cost far less than one comparison per item
+    yar_reset(&b);
+    *yar_append(&b) = 99999;
+    comparisons = 0;
+    yar_merge(&dest, &a, &b, counting_compare_int);
+    assert(dest.count == 100001);
+    for(size_t i = 1; i < dest.count; i++) assert(dest.items[i - 1] <= dest.items[i]);
+    assert(comparisons < 1000);
+
+    yar_free(&a);
+    yar_free(&b);
+    yar_free(&dest);
+}
@@ -27,6 +27,7 @@
 
 #include <stddef.h> // size_t
 #include <string.h> // strlen
+#include <stdint.h> // uint64_t
 
 /*
  * yar(type) - Declare a new basic dynamic array
@@ -41,6 +42,11 @@
  *
  * yar_insert(array, index, num) - Insert items somewhere within the array. Moves items to higher indexes as required. Returns &array[index]
  *
+ * yar_insert_many_at(array, insertions, num) - Apply num yar_insertion's, sorted by index, in one pass.
+ *      Each index is a position in the array before any of the insertions. NULL data inserts zeroed items.
+ *      Every existing item is moved at most once. Returns array->items.
+ *      The data must not point into the array, as the array may be reallocated before it is read.
+ *
  * yar_remove(array, index, num) - Remove items from somewhere within the array. Moves items to lower indexes as required.
  *
  * yar_reset(array) - Reset the count of elements to 0, to re-use the memory. Does not free the memory.
@@ -48,9 +54,160 @@
  * yar_init(array) - Set items, count, and capacity to 0. Can usually be avoided with <declaration> = {0};
  *
  * yar_free(array) - Free items memory, and set the items, count, and capacity to 0.
+ *
+ * Slices and clones:
+ *
+ * yar_slice(type) - Declare a borrowed view of items: just items and count. Functions which only read
+ *      items and count accept slices too, e.g. yar_lower_bound, the a and b of yar_union, yar_append_many's data.
+ *
+ * yar_slice_from(slice, array, index, num) - Point slice at num items of array (or another slice) from index.
+ *      Valid until the array is changed.
+ *
+ * yar_clone(dest, src) - Make dest share src's items, copy-on-write, releasing dest's own items.
+ *      Returns 0 on allocation failure, leaving dest as it was.
+ *      Cloning a shared array is O(1). Cloning a private array copies its items into shared storage for dest,
+ *      and leaves src, and any pointers into it, as they were.
+ *      A shared array has a capacity of YAR_SHARED. Changing it through yar functions makes a private copy first,
+ *      and yar_free only frees the items once every array sharing them has been freed.
+ *      Arrays sharing items may be used on different threads, as the reference count is atomic on GCC, Clang,
+ *      and MSVC. With other compilers, arrays sharing items must stay on one thread.
+ *      Each array must still only be used by one thread at a time.
+ *
+ * yar_share(array) - Move the array's own items into shared storage, so every clone of it is O(1).
+ *      Like any reallocation, this invalidates pointers and slices into the array. Returns 0 on allocation failure.
+ *
+ * yar_unshare(array) - Make a private copy of shared items, for writing to items directly. Does nothing otherwise.
+ *      Returns 0 on allocation failure.
+ *
+ * Sorted arrays. `cmp` is a qsort-style comparison function, `key` is a pointer to an item:
+ *
+ * yar_lower_bound(array, key, cmp) - Index of the first item not less than *key (or count)
+ *
+ * yar_upper_bound(array, key, cmp) - Index of the first item greater than *key (or count)
+ *
+ * yar_sorted_insert(array, key, cmp) - Insert a copy of *key, keeping the array sorted. Returns a pointer to it. key must not point into the array.
+ *
+ * yar_dedup(array, cmp) - Remove adjacent equal items, keeping the first. Returns the new count,
+ *      or 0 if shared items couldn't be copied.
+ *
+ * yar_merge(dest, a, b, cmp) - Append all items of sorted a and b to dest, in sorted order
+ *
+ * yar_union(dest, a, b, cmp) - Append items in either sorted a or b to dest, in sorted order
+ *
+ * yar_intersection(dest, a, b, cmp) - Append items in both sorted a and b to dest, in sorted order
+ *
+ * yar_difference(dest, a, b, cmp) - Append items in sorted a but not in b to dest, in sorted order
+ *
+ * Gap buffers. Items before the cursor are at the start of `items`, items after it are at the end, and
+ * the unused capacity is the gap between them. Edits near the cursor only move the items in between.
+ *
+ * yar_gap(type) - Declare a new gap buffer
+ *
+ * yar_gap_at(buffer, index) - Pointer to the item at a logical index
+ *
+ * yar_gap_move(buffer, index) - Move the cursor (and gap) to index. Costs the distance moved.
+ *
+ * yar_gap_insert(buffer, index, num) - Insert num zeroed items at index, leaving the cursor after them. Returns a pointer to them.
+ *
+ * yar_gap_remove(buffer, index, num) - Remove num items from index, leaving the cursor at index
+ *
+ * yar_gap_before(buffer), yar_gap_after(buffer) - Pointers to the two contiguous spans around the gap.
+ *      These hold `cursor` and `count - cursor` items respectively.
+ *
+ * yar_gap_flatten(buffer) - Close the gap by moving the cursor to the end. Returns items, which then holds count items.
+ *
+ * yar_gap_free(buffer) - Free items memory, and set the items, count, capacity, and cursor to 0.
+ *
+ * Packed integers. A yar_packed holds uint64_t values in blocks of YAR_PACKED_BLOCK. Each block stores
+ * its first value, and the rest as bit-packed differences from the previous value (less the smallest
+ * difference). Sorted ids and timestamps pack to a few bits each. Zero-initialise it like a yar.
+ *
+ * yar_packed_append(packed, value) - Append a value. Returns 0 on allocation failure.
+ *
+ * yar_packed_append_many(packed, data, num) - Append a copy of existing values. Returns 0 on allocation failure.
+ *
+ * yar_packed_get(packed, index) - Decode the value at index. Costs at most one block.
+ *
+ * yar_packed_block_count(packed) - Number of blocks, including the partially filled last block
+ *
+ * yar_packed_decode_block(packed, block, out) - Decode a whole block into out[YAR_PACKED_BLOCK]. Returns the count decoded.
+ *
+ * yar_packed_from(packed, array) - Append all values of a yar(uint64_t)
+ *
+ * yar_packed_to(packed, array) - Append all values to a yar(uint64_t). Returns a pointer to the first.
+ *
+ * yar_packed_free(packed) - Free all memory, and reset to empty.
+ *
+ * Published snapshots. One writer thread appends to an array and publishes (items, count) snapshots of it.
+ * Any number of reader threads read the latest snapshot without locks. Buffers the writer has moved away
+ * from are only freed once no reader can still be using them (epoch-based reclamation). Each reader thread
+ * has its own yar_reader slot, on its own cache line, from an array given to the yar_publisher.
+ * Heap-allocated reader arrays need 64-byte alignment, e.g. from aligned_alloc.
+ * Requires GCC or Clang atomic builtins.
+ *
+ * yar_published_append(publisher, array) - yar_append, but retires the old buffer instead of freeing it
+ *
+ * yar_published_reserve(publisher, array, extra) - yar_reserve, but retires the old buffer instead of freeing it
+ *
+ * yar_published_append_many(publisher, array, data, num) - yar_append_many, but retires the old buffer instead of freeing it
+ *
+ * yar_publish(publisher, array) - Publish the current items and count to readers. Returns 0 on allocation failure.
+ *
+ * yar_read_begin(publisher, reader) - Start reading. Returns the latest yar_snapshot, which stays valid until yar_read_end.
+ *
+ * yar_read_end(reader) - Finish reading
+ *
+ * yar_publisher_reclaim(publisher) - Free retired buffers no reader can be using. yar_publish also does this.
+ *
+ * yar_publisher_free(publisher) - Free all retired buffers and snapshots. No reader may be reading.
+ *      The array itself is still freed with yar_free.
+ *
+ * Only items beyond the published count may be changed. To make other changes, build a new array and publish that.
+ * The array must not be shared with yar_clone.
+ *
+ * Parallel bulk operations. These split the items into chunks of about YAR_PARALLEL_CHUNK bytes and run them
+ * on a yar_pool. They run serially when the pool is NULL, or for less than YAR_PARALLEL_MIN bytes.
+ * Thread pools need YAR_THREADS defined for the implementation (and pthreads); otherwise yar_pool_create
+ * returns NULL, and everything runs serially. A pool must only be used by one thread at a time.
+ *
+ * yar_pool_create(threads) - Create a pool of threads (0 for one per CPU). The calling thread also does work.
+ *
+ * yar_pool_destroy(pool) - Stop and free the pool
+ *
+ * yar_parallel_for(pool, array, fn, context) - Call fn(items, count, context) over chunks covering all items.
+ *      fn may change the items. Returns 0 if shared items couldn't be copied.
+ *
+ * yar_parallel_fill(pool, array, value) - Set every item to a copy of *value. Returns 0 if shared items couldn't be copied.
+ *
+ * yar_parallel_reserve(pool, array, extra) - yar_reserve, zeroing the new space in parallel
+ *
+ * yar_parallel_append_many(pool, array, data, num) - yar_append_many, copying in parallel
+ *
+ * yar_parallel_copy(pool, dest, src) - Replace the items of dest with a copy of the items of src
+ *
+ * Ropes. A yar_rope builds a string in a chain of chunks of YAR_ROPE_CHUNK bytes, so growing never copies
+ * what is already there. Borrowed buffers can be spliced in without copying. Zero-initialise it like a yar.
+ * Chunks are read-only views for the rope's own functions to manage: read their items and count, but never pass
+ * them to other yar functions, which could realloc memory the rope doesn't own, or move memory it still uses.
+ * Chunks with a capacity of 0 don't own their memory: they are borrowed, or continue in the unused space of an
+ * earlier chunk, so small appends between borrowed buffers don't waste a chunk each.
+ *
+ * yar_rope_append(rope, data, size) - Append a copy of data. Returns 0 on allocation failure.
+ *
+ * yar_rope_append_cstr(rope, data) - Append a copy of a C string (nul-terminated char array)
+ *
+ * yar_rope_borrow(rope, data, size) - Append data without copying. It must stay valid while the rope is used.
+ *
+ * yar_rope_write(rope, fd) - Write everything to a file descriptor with writev. Returns 0, or -1 with errno set.
+ *      POSIX only.
+ *
+ * yar_rope_flatten(rope, array) - Append everything to a char yar. Returns a pointer to the first char appended.
+ *
+ * yar_rope_free(rope) - Free owned chunks, and reset to empty
  */
 
 #define yar(type)   struct { type *items; size_t count; size_t capacity; }
+#define YAR_SHARED  ((size_t)-1) // The capacity of arrays sharing their items with yar_clone
 #define yar_append(array)   ((_yar_append((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0])), \
                               &(array)->items[(array)->count - 1]))
 #define yar_reserve(array, extra)       ((_yar_reserve((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), (extra)), \
@@ -58,10 +215,128 @@
 #define yar_append_many(array, data, num)   ((_yar_append_many((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), 1 ? (data) : ((array)->items), (num)) ))
 #define yar_append_cstr(array, data)        yar_append_many(array, data, strlen(data))
 #define yar_insert(array, index, num)       ((_yar_insert((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), index, num) ))
-#define yar_remove(array, index, num)       ((_yar_remove((void**)&(array)->items, &(array)->count, sizeof((array)->items[0]), index, num) ))
+#define yar_insert_many_at(array, insertions, num)  ((_yar_insert_many_at((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), insertions, num) ))
+#define yar_remove(array, index, num)       ((_yar_remove((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), index, num) ))
 #define yar_reset(array)    (((array)->count = 0))
 #define yar_init(array)     ((array)->items = NULL, (array)->count = 0, (array)->capacity = 0)
-#define yar_free(array)     ((_yar_free((array)->items)), (array)->items = NULL, (array)->count = 0, (array)->capacity = 0)
+#define yar_free(array)     ((_yar_release((array)->items, (array)->capacity)), (array)->items = NULL, (array)->count = 0, (array)->capacity = 0)
+
+#define yar_slice(type)     struct { type *items; size_t count; }
+#define yar_slice_from(slice, array, index, num)    ((slice)->items = (array)->items + (index), (slice)->count = (num))
+#define yar_clone(dest, src)    (_yar_clone((void**)&(dest)->items, &(dest)->capacity, 1 ? (src)->items : ((dest)->items), (src)->count, (src)->capacity, \
+                                            sizeof((src)->items[0])) ? ((dest)->count = (src)->count, 1) : 0)
+#define yar_share(array)    ((_yar_share((void**)&(array)->items, (array)->count, &(array)->capacity, sizeof((array)->items[0])) ))
+#define yar_unshare(array)  ((_yar_unshare((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0])) ))
+
+#define yar_lower_bound(array, key, cmp)    ((_yar_lower_bound((array)->items, (array)->count, sizeof((array)->items[0]), 1 ? (key) : ((array)->items), (cmp)) ))
+#define yar_upper_bound(array, key, cmp)    ((_yar_upper_bound((array)->items, (array)->count, sizeof((array)->items[0]), 1 ? (key) : ((array)->items), (cmp)) ))
+#define yar_sorted_insert(array, key, cmp)  ((_yar_sorted_insert((void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), 1 ? (key) : ((array)->items), (cmp)) ))
+#define yar_dedup(array, cmp)               ((yar_unshare(array) ? _yar_dedup((array)->items, &(array)->count, sizeof((array)->items[0]), (cmp)) : 0))
+#define _yar_set_args(dest, a, b, cmp)      (void**)&(dest)->items, &(dest)->count, &(dest)->capacity, sizeof((dest)->items[0]), \
+                                            1 ? (a)->items : ((dest)->items), (a)->count, 1 ? (b)->items : ((dest)->items), (b)->count, (cmp)
+#define yar_merge(dest, a, b, cmp)          ((_yar_merge(_yar_set_args(dest, a, b, cmp)) ))
+#define yar_union(dest, a, b, cmp)          ((_yar_union(_yar_set_args(dest, a, b, cmp)) ))
+#define yar_intersection(dest, a, b, cmp)   ((_yar_intersection(_yar_set_args(dest, a, b, cmp)) ))
+#define yar_difference(dest, a, b, cmp)     ((_yar_difference(_yar_set_args(dest, a, b, cmp)) ))
+
+#define yar_gap(type)   struct { type *items; size_t count; size_t capacity; size_t cursor; }
+#define yar_gap_at(buffer, index)           (&(buffer)->items[(index) < (buffer)->cursor ? (index) : (index) + (buffer)->capacity - (buffer)->count])
+#define yar_gap_move(buffer, index)         ((_yar_gap_move((buffer)->items, (buffer)->count, (buffer)->capacity, &(buffer)->cursor, sizeof((buffer)->items[0]), index) ))
+#define yar_gap_insert(buffer, index, num)  ((_yar_gap_insert((void**)&(buffer)->items, &(buffer)->count, &(buffer)->capacity, &(buffer)->cursor, sizeof((buffer)->items[0]), index, num) ))
+#define yar_gap_remove(buffer, index, num)  ((_yar_gap_remove((buffer)->items, &(buffer)->count, (buffer)->capacity, &(buffer)->cursor, sizeof((buffer)->items[0]), index, num) ))
+#define yar_gap_before(buffer)              ((buffer)->items)
+#define yar_gap_after(buffer)               (&(buffer)->items[(buffer)->cursor + (buffer)->capacity - (buffer)->count])
+#define yar_gap_flatten(buffer)             (yar_gap_move(buffer, (buffer)->count), (buffer)->items)
+#define yar_gap_free(buffer)                (yar_free(buffer), (buffer)->cursor = 0)
+
+#define YAR_PACKED_BLOCK 128
+typedef struct {
+    uint64_t first;         // First value of the block, stored as-is
+    uint64_t min_delta;     // Smallest difference between neighbouring values
+    size_t offset;          // Index into words of the packed differences
+    size_t bits;            // Bits per packed difference, 0 to 64
+} yar_packed_block;
+
+typedef struct {
+    yar(uint64_t) words;
+    yar(yar_packed_block) blocks;
+    uint64_t tail[YAR_PACKED_BLOCK];    // Values not yet packed into a block
+    size_t tail_count;
+    size_t count;
+} yar_packed;
+
+#define yar_packed_block_count(packed)  ((packed)->blocks.count + ((packed)->tail_count != 0))
+#define yar_packed_from(packed, array)  (yar_packed_append_many((packed), 1 ? (array)->items : (uint64_t*)0, (array)->count))
+#define yar_packed_to(packed, array)    ((uint64_t*)_yar_packed_to((packed), (void**)&(array)->items, &(array)->count, &(array)->capacity, \
+                                                                   sizeof(*(1 ? (array)->items : (uint64_t*)0))))
+
+typedef struct {
+    const void* items;
+    size_t count;
+} yar_snapshot;
+
+#if defined(__cplusplus)
+    #define _YAR_ALIGN(n) alignas(n)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+    #define _YAR_ALIGN(n) _Alignas(n)
+#elif defined(_MSC_VER)
+    #define _YAR_ALIGN(n) __declspec(align(n))
+#else
+    #define _YAR_ALIGN(n) __attribute__((aligned(n)))
+#endif
+
+// Aligned to a cache line, so neighbouring readers in an array never share one
+typedef struct {
+    _YAR_ALIGN(64) uint64_t epoch;  // 0 when not reading, otherwise the epoch reading started in
+    char padding[64 - sizeof(uint64_t)];
+} yar_reader;
+typedef char _yar_reader_is_one_cache_line[sizeof(yar_reader) == 64 ? 1 : -1];
+
+typedef struct {
+    void* pointer;
+    uint64_t epoch;         // Freed once all readers are past this epoch. UINT64_MAX until published.
+} yar_retired;
+
+typedef struct {
+    yar_reader* readers;    // Set these two before use. One slot per reader thread.
+    size_t reader_count;
+    yar_snapshot* current;
+    uint64_t epoch;
+    yar(yar_retired) retired;
+} yar_publisher;
+
+#define yar_published_append(publisher, array)      ((_yar_published_append((publisher), (void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0])), \
+                                                      &(array)->items[(array)->count - 1]))
+#define yar_published_reserve(publisher, array, extra)  ((_yar_published_reserve((publisher), (void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), (extra)), \
+                                                          &(array)->items[(array)->count]))
+#define yar_published_append_many(publisher, array, data, num)  ((_yar_published_append_many((publisher), (void**)&(array)->items, &(array)->count, &(array)->capacity, \
+                                                                                           sizeof((array)->items[0]), 1 ? (data) : ((array)->items), (num)) ))
+#define yar_publish(publisher, array)               ((_yar_publish((publisher), (array)->items, (array)->count) ))
+
+typedef struct yar_pool yar_pool;
+typedef void (*yar_range_fn)(void* items, size_t count, void* context);
+
+#define yar_parallel_for(pool, array, fn, context)  ((yar_unshare(array) ? (_yar_parallel_for((pool), (array)->items, (array)->count, sizeof((array)->items[0]), \
+                                                                        (fn), (context)), 1) : 0))
+#define yar_parallel_fill(pool, array, value)       ((yar_unshare(array) ? (_yar_parallel_fill((pool), (array)->items, (array)->count, sizeof((array)->items[0]), \
+                                                                         1 ? (value) : ((array)->items)), 1) : 0))
+#define yar_parallel_reserve(pool, array, extra)    ((_yar_parallel_reserve((pool), (void**)&(array)->items, &(array)->count, &(array)->capacity, sizeof((array)->items[0]), (extra)), \
+                                                      &(array)->items[(array)->count]))
+#define yar_parallel_append_many(pool, array, data, num)    ((_yar_parallel_append_many((pool), (void**)&(array)->items, &(array)->count, &(array)->capacity, \
+                                                                                     sizeof((array)->items[0]), 1 ? (data) : ((array)->items), (num)) ))
+#define yar_parallel_copy(pool, dest, src)          (yar_reset(dest), yar_parallel_append_many(pool, dest, (src)->items, (src)->count))
+
+typedef yar(char) yar_rope_chunk; // Read-only: only items and count are meaningful outside the rope functions
+typedef struct {
+    yar(yar_rope_chunk) chunks;
+    size_t count;           // Total bytes in all chunks
+    char* spare;            // Unused space at the end of the newest allocated chunk
+    size_t spare_count;
+} yar_rope;
+
+#define yar_rope_append_cstr(rope, data)    yar_rope_append(rope, data, strlen(data))
+#define yar_rope_flatten(rope, array)       ((char*)_yar_rope_flatten((rope), (void**)&(array)->items, &(array)->count, &(array)->capacity, \
+                                                                      sizeof(*(1 ? (array)->items : (char*)0))))
 
 #ifndef YARAPI
     #define YARAPI // nothing; overridable if needed.
@@ -71,14 +346,80 @@
     extern "C" {
 #endif
 
+// qsort-style comparison: negative, zero, or positive for a < b, a == b, a > b
+typedef int (*yar_compare_fn)(const void* a, const void* b);
+
+typedef struct {
+    size_t index;           // Where to insert, in terms of the array before any insertions
+    size_t count;           // Number of items to insert
+    const void* data;       // Items to copy in, or NULL for zeroed items. Must not point into the array.
+} yar_insertion;
+
 // Implementation functions
 YARAPI void* _yar_append(void** items_pointer, size_t* count, size_t* capacity, size_t item_size);
 YARAPI void* _yar_append_many(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, void* data, size_t extra);
 YARAPI void* _yar_reserve(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra);
 YARAPI void* _yar_insert(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t index, size_t extra);
-YARAPI void* _yar_remove(void** items_pointer, size_t* count, size_t item_size, size_t index, size_t remove);
+YARAPI void* _yar_insert_many_at(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const yar_insertion* insertions, size_t num);
+YARAPI void* _yar_remove(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t index, size_t remove);
 YARAPI void* _yar_realloc(void* p, size_t new_size);
 YARAPI void _yar_free(void* p);
+YARAPI int _yar_share(void** items_pointer, size_t count, size_t* capacity, size_t item_size);
+YARAPI int _yar_clone(void** dest_items, size_t* dest_capacity, const void* items, size_t count, size_t capacity, size_t item_size);
+YARAPI void _yar_release(void* items, size_t capacity);
+YARAPI int _yar_unshare(void** items_pointer, size_t* count, size_t* capacity, size_t item_size);
+
+// Sorted array functions
+YARAPI size_t _yar_lower_bound(const void* items, size_t count, size_t item_size, const void* key, yar_compare_fn cmp);
+YARAPI size_t _yar_upper_bound(const void* items, size_t count, size_t item_size, const void* key, yar_compare_fn cmp);
+YARAPI void* _yar_sorted_insert(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const void* key, yar_compare_fn cmp);
+YARAPI size_t _yar_dedup(void* items, size_t* count, size_t item_size, yar_compare_fn cmp);
+YARAPI void* _yar_merge(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                        const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp);
+YARAPI void* _yar_union(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                        const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp);
+YARAPI void* _yar_intersection(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                               const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp);
+YARAPI void* _yar_difference(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                             const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp);
+
+// Gap buffer functions
+YARAPI void _yar_gap_move(void* items, size_t count, size_t capacity, size_t* cursor, size_t item_size, size_t index);
+YARAPI void* _yar_gap_insert(void** items_pointer, size_t* count, size_t* capacity, size_t* cursor, size_t item_size, size_t index, size_t extra);
+YARAPI void _yar_gap_remove(void* items, size_t* count, size_t capacity, size_t* cursor, size_t item_size, size_t index, size_t remove);
+
+// Packed integer functions
+YARAPI int yar_packed_append(yar_packed* packed, uint64_t value);
+YARAPI int yar_packed_append_many(yar_packed* packed, const uint64_t* data, size_t num);
+YARAPI uint64_t yar_packed_get(const yar_packed* packed, size_t index);
+YARAPI size_t yar_packed_decode_block(const yar_packed* packed, size_t block, uint64_t* out);
+YARAPI void* _yar_packed_to(const yar_packed* packed, void** items_pointer, size_t* count, size_t* capacity, size_t item_size);
+YARAPI void yar_packed_free(yar_packed* packed);
+
+// Published snapshot functions
+YARAPI void* _yar_published_append(yar_publisher* publisher, void** items_pointer, size_t* count, size_t* capacity, size_t item_size);
+YARAPI void* _yar_published_append_many(yar_publisher* publisher, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const void* data, size_t extra);
+YARAPI void* _yar_published_reserve(yar_publisher* publisher, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra);
+YARAPI int _yar_publish(yar_publisher* publisher, const void* items, size_t count);
+YARAPI yar_snapshot yar_read_begin(yar_publisher* publisher, yar_reader* reader);
+YARAPI void yar_read_end(yar_reader* reader);
+YARAPI void yar_publisher_reclaim(yar_publisher* publisher);
+YARAPI void yar_publisher_free(yar_publisher* publisher);
+
+// Parallel functions
+YARAPI yar_pool* yar_pool_create(size_t threads);
+YARAPI void yar_pool_destroy(yar_pool* pool);
+YARAPI void _yar_parallel_for(yar_pool* pool, void* items, size_t count, size_t item_size, yar_range_fn fn, void* context);
+YARAPI void _yar_parallel_fill(yar_pool* pool, void* items, size_t count, size_t item_size, const void* value);
+YARAPI void* _yar_parallel_reserve(yar_pool* pool, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra);
+YARAPI void* _yar_parallel_append_many(yar_pool* pool, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const void* data, size_t extra);
+
+// Rope functions
+YARAPI int yar_rope_append(yar_rope* rope, const char* data, size_t size);
+YARAPI int yar_rope_borrow(yar_rope* rope, const char* data, size_t size);
+YARAPI int yar_rope_write(const yar_rope* rope, int fd);
+YARAPI void* _yar_rope_flatten(const yar_rope* rope, void** items_pointer, size_t* count, size_t* capacity, size_t item_size);
+YARAPI void yar_rope_free(yar_rope* rope);
 
 #ifdef __cplusplus
     }
@@ -100,6 +441,22 @@ YARAPI void _yar_free(void* p);
   #define YAR_FREE free
 #endif
 
+#ifndef YAR_MIN_GALLOP
+  #define YAR_MIN_GALLOP 7
+#endif
+
+#ifndef YAR_PARALLEL_MIN
+  #define YAR_PARALLEL_MIN (1 << 20)
+#endif
+
+#ifndef YAR_PARALLEL_CHUNK
+  #define YAR_PARALLEL_CHUNK (256 << 10)
+#endif
+
+#ifndef YAR_ROPE_CHUNK
+  #define YAR_ROPE_CHUNK (16 << 10)
+#endif
+
 #include <string.h> // mem* functions
 YARAPI void* _yar_append(void** items_pointer, size_t* count, size_t* capacity, size_t item_size)
 {
@@ -118,20 +475,68 @@ YARAPI void* _yar_append_many(void** items_pointer, size_t* count, size_t* capac
     return result;
 }
 
-YARAPI void* _yar_reserve(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra)
+// Shared items from yar_clone are preceded by a reference count
+typedef union {
+    size_t refs;
+    long double align;
+    void* align_pointer;
+} _yar_shared;
+
+// Atomic reference counting, so clones can be used on different threads. Compilers without
+// these fall back to a plain count.
+#if defined(__GNUC__) || defined(__clang__)
+  #define _yar_refs_increment(refs) __atomic_add_fetch((refs), 1, __ATOMIC_RELAXED)
+  #define _yar_refs_decrement(refs) __atomic_sub_fetch((refs), 1, __ATOMIC_ACQ_REL)
+#elif defined(_MSC_VER) && defined(_WIN64)
+  #include <intrin.h>
+  #define _yar_refs_increment(refs) ((size_t)_InterlockedIncrement64((__int64 volatile*)(refs)))
+  #define _yar_refs_decrement(refs) ((size_t)_InterlockedDecrement64((__int64 volatile*)(refs)))
+#elif defined(_MSC_VER)
+  #include <intrin.h>
+  #define _yar_refs_increment(refs) ((size_t)_InterlockedIncrement((long volatile*)(refs)))
+  #define _yar_refs_decrement(refs) ((size_t)_InterlockedDecrement((long volatile*)(refs)))
+#else
+  #define _yar_refs_increment(refs) (++*(refs))
+  #define _yar_refs_decrement(refs) (--*(refs))
+#endif
+
+// The capacity to grow to, to hold newcount items. Every growing function uses this policy.
+static size_t _yar_grow_capacity(size_t capacity, size_t newcount)
+{
+    size_t newcap = (capacity < YAR_MIN_CAP) ? YAR_MIN_CAP : capacity * 8 / 5;
+    return (newcap < newcount) ? newcount : newcap;
+}
+
+// Reserve, without zeroing the new space
+static void* _yar_grow(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra)
 {
     char* items = *items_pointer;
+    if (*capacity == YAR_SHARED) {
+        // Shared, so copy on this first write
+        size_t newcap = _yar_grow_capacity(0, *count + extra);
+        char* next = _yar_realloc(NULL, newcap * item_size);
+        if (next == NULL) return NULL;
+        memcpy(next, items, *count * item_size);
+        _yar_release(items, YAR_SHARED);
+        items = next;
+        *items_pointer = next;
+        *capacity = newcap;
+    }
     size_t newcount = *count + extra;
     if (newcount > *capacity) {
-        size_t newcap = (*capacity < YAR_MIN_CAP) ? YAR_MIN_CAP : *capacity * 8 / 5;
-        if (newcap < newcount) newcap = newcount;
+        size_t newcap = _yar_grow_capacity(*capacity, newcount);
         void* next = _yar_realloc(items, newcap * item_size);
         if (next == NULL) return NULL;
         items = next;
         *items_pointer = next;
         *capacity = newcap;
     }
-    void* result = items + (*count * item_size);
+    return items + (*count * item_size);
+}
+
+YARAPI void* _yar_reserve(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra)
+{
+    void* result = _yar_grow(items_pointer, count, capacity, item_size, extra);
     if (extra && result) memset(result, 0, item_size * extra);
     return result;
 }
@@ -151,7 +556,38 @@ YARAPI void* _yar_insert(void** items_pointer, size_t* count, size_t* capacity,
     return items + index * item_size;
 }
 
-YARAPI void* _yar_remove(void** items_pointer, size_t* count, size_t item_size, size_t index, size_t remove)
+YARAPI void* _yar_insert_many_at(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const yar_insertion* insertions, size_t num)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < num; i++) total += insertions[i].count;
+    if (total == 0) return *items_pointer;
+    char* items = _yar_grow(items_pointer, count, capacity, item_size, total);
+    if (items == NULL) return NULL;
+    items = *items_pointer;
+
+    // From the back, move each segment of existing items straight to its final place
+    size_t end = *count;
+    size_t shift = total;
+    for (size_t i = num; i-- > 0;) {
+        const yar_insertion* insertion = &insertions[i];
+        size_t index = insertion->index < end ? insertion->index : end;
+        if (index < end) {
+            memmove(&items[item_size * (index + shift)], &items[item_size * index], item_size * (end - index));
+        }
+        shift -= insertion->count;
+        char* dest = &items[item_size * (index + shift)];
+        if (insertion->data) {
+            memcpy(dest, insertion->data, item_size * insertion->count);
+        } else {
+            memset(dest, 0, item_size * insertion->count);
+        }
+        end = index;
+    }
+    *count += total;
+    return items;
+}
+
+YARAPI void* _yar_remove(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t index, size_t remove)
 {
     if(remove >= *count) {
         *count = 0;
@@ -160,6 +596,7 @@ YARAPI void* _yar_remove(void** items_pointer, size_t* count, size_t item_size,
     if (index >= *count) {
         return *items_pointer;
     }
+    if (_yar_grow(items_pointer, count, capacity, item_size, 0) == NULL) return NULL;
     char* items = *items_pointer;
     memmove(&items[item_size * index], &items[item_size * (index + remove)], item_size * (*count - (index + remove)));
     *count -= remove;
@@ -179,6 +616,869 @@ YARAPI void _yar_free(void* p)
     YAR_FREE(p);
 }
 
+// Copy items after a reference count of 1
+static void* _yar_shared_copy(const void* items, size_t count, size_t item_size)
+{
+    _yar_shared* shared = _yar_realloc(NULL, sizeof(_yar_shared) + count * item_size);
+    if (shared == NULL) return NULL;
+    shared->refs = 1;
+    memcpy(shared + 1, items, count * item_size);
+    return shared + 1;
+}
+
+YARAPI int _yar_share(void** items_pointer, size_t count, size_t* capacity, size_t item_size)
+{
+    if (*capacity == YAR_SHARED || *items_pointer == NULL) return 1;
+    void* shared = _yar_shared_copy(*items_pointer, count, item_size);
+    if (shared == NULL) return 0;
+    _yar_free(*items_pointer);
+    *items_pointer = shared;
+    *capacity = YAR_SHARED;
+    return 1;
+}
+
+YARAPI int _yar_clone(void** dest_items, size_t* dest_capacity, const void* items, size_t count, size_t capacity, size_t item_size)
+{
+    void* shared = NULL;
+    if (capacity == YAR_SHARED) {
+        _yar_refs_increment(&((_yar_shared*)items - 1)->refs);
+        shared = (void*)items;
+    } else if (items != NULL) {
+        // Leave src private, so pointers into it stay valid
+        shared = _yar_shared_copy(items, count, item_size);
+        if (shared == NULL) return 0;
+    }
+    // Released after taking the new reference, so cloning an array into itself is safe
+    _yar_release(*dest_items, *dest_capacity);
+    *dest_items = shared;
+    *dest_capacity = shared ? YAR_SHARED : 0;
+    return 1;
+}
+
+YARAPI void _yar_release(void* items, size_t capacity)
+{
+    if (capacity != YAR_SHARED) {
+        _yar_free(items);
+        return;
+    }
+    _yar_shared* shared = (_yar_shared*)items - 1;
+    if (_yar_refs_decrement(&shared->refs) == 0) _yar_free(shared);
+}
+
+YARAPI int _yar_unshare(void** items_pointer, size_t* count, size_t* capacity, size_t item_size)
+{
+    if (*capacity != YAR_SHARED) return 1;
+    return _yar_grow(items_pointer, count, capacity, item_size, 0) != NULL;
+}
+
+// Binary search for the first item where cmp(item, key) >= bias: bias 0 is the
+// lower bound, and bias 1 is the upper bound. The loop body has no branch on
+// the comparison result, so it compiles to a conditional move.
+static size_t _yar_bound(const char* items, size_t count, size_t item_size, const void* key, yar_compare_fn cmp, int bias)
+{
+    if (count == 0) return 0;
+    size_t base = 0;
+    while (count > 1) {
+        size_t half = count / 2;
+        base = (cmp(items + (base + half) * item_size, key) < bias) ? base + half : base;
+        count -= half;
+    }
+    return base + (cmp(items + base * item_size, key) < bias);
+}
+
+// Exponential search from the start of items, then binary search the final
+// step. Costs O(log distance), so runs of items can be skipped cheaply.
+static size_t _yar_gallop(const char* items, size_t count, size_t item_size, const void* key, yar_compare_fn cmp, int bias)
+{
+    size_t lo = 0, step = 1;
+    while (lo + step - 1 < count) {
+        size_t probe = lo + step - 1;
+        if (cmp(items + probe * item_size, key) >= bias) {
+            return lo + _yar_bound(items + lo * item_size, probe - lo, item_size, key, cmp, bias);
+        }
+        lo = probe + 1;
+        step *= 2;
+    }
+    return lo + _yar_bound(items + lo * item_size, count - lo, item_size, key, cmp, bias);
+}
+
+YARAPI size_t _yar_lower_bound(const void* items, size_t count, size_t item_size, const void* key, yar_compare_fn cmp)
+{
+    return _yar_bound(items, count, item_size, key, cmp, 0);
+}
+
+YARAPI size_t _yar_upper_bound(const void* items, size_t count, size_t item_size, const void* key, yar_compare_fn cmp)
+{
+    return _yar_bound(items, count, item_size, key, cmp, 1);
+}
+
+YARAPI void* _yar_sorted_insert(void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const void* key, yar_compare_fn cmp)
+{
+    // Insert after any equal items, so equal items keep their insertion order
+    size_t index = _yar_bound(*items_pointer, *count, item_size, key, cmp, 1);
+    char* result = _yar_insert(items_pointer, count, capacity, item_size, index, 1);
+    if (result != NULL) memcpy(result, key, item_size);
+    return result;
+}
+
+YARAPI size_t _yar_dedup(void* items, size_t* count, size_t item_size, yar_compare_fn cmp)
+{
+    char* p = items;
+    if (*count == 0) return 0;
+    size_t out = 1;
+    for (size_t i = 1; i < *count; i++) {
+        if (cmp(p + (out - 1) * item_size, p + i * item_size) != 0) {
+            if (out != i) memcpy(p + out * item_size, p + i * item_size, item_size);
+            out++;
+        }
+    }
+    *count = out;
+    return out;
+}
+
+enum { _YAR_MERGE, _YAR_UNION, _YAR_INTERSECTION, _YAR_DIFFERENCE };
+
+// All sorted set operations share this one loop. It steps through both inputs
+// one item at a time, but once one input has won YAR_MIN_GALLOP times in a row
+// it gallops to find the whole run, which is then copied (or skipped) in bulk.
+// Interleaved inputs cost about one comparison per item, and skewed inputs only
+// O(log) per run.
+static void* _yar_set_op(int op, void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                         const char* a, size_t a_count, const char* b, size_t b_count, yar_compare_fn cmp)
+{
+    size_t most = (op == _YAR_MERGE || op == _YAR_UNION) ? a_count + b_count
+                : (op == _YAR_INTERSECTION && b_count < a_count) ? b_count : a_count;
+    // Every item written is copied from an input, so there is no need to zero
+    char* out = _yar_grow(items_pointer, count, capacity, item_size, most);
+    if (out == NULL) return NULL;
+    char* result = out;
+    int keep_a = (op != _YAR_INTERSECTION);
+    int keep_b = (op == _YAR_MERGE || op == _YAR_UNION);
+
+    size_t i = 0, j = 0;
+    size_t a_wins = 0, b_wins = 0;
+    while (i < a_count && j < b_count) {
+        const char* x = a + i * item_size;
+        const char* y = b + j * item_size;
+        int c = cmp(x, y);
+        if (c < 0 || (c == 0 && op == _YAR_MERGE)) {
+            // Merge takes equal items from `a` first, so it stays stable
+            size_t n = 1;
+            b_wins = 0;
+            if (++a_wins >= YAR_MIN_GALLOP) {
+                n += _yar_gallop(x + item_size, a_count - i - 1, item_size, y, cmp, op == _YAR_MERGE);
+                // Stay galloping only while it keeps paying off
+                if (n < YAR_MIN_GALLOP) a_wins = 0;
+            }
+            if (keep_a) {
+                memcpy(out, x, n * item_size);
+                out += n * item_size;
+            }
+            i += n;
+        } else if (c > 0) {
+            size_t n = 1;
+            a_wins = 0;
+            if (++b_wins >= YAR_MIN_GALLOP) {
+                n += _yar_gallop(y + item_size, b_count - j - 1, item_size, x, cmp, 0);
+                if (n < YAR_MIN_GALLOP) b_wins = 0;
+            }
+            if (keep_b) {
+                memcpy(out, y, n * item_size);
+                out += n * item_size;
+            }
+            j += n;
+        } else {
+            if (op != _YAR_DIFFERENCE) {
+                memcpy(out, x, item_size);
+                out += item_size;
+            }
+            i++;
+            j++;
+            a_wins = b_wins = 0;
+        }
+    }
+    if (keep_a && i < a_count) {
+        memcpy(out, a + i * item_size, (a_count - i) * item_size);
+        out += (a_count - i) * item_size;
+    }
+    if (keep_b && j < b_count) {
+        memcpy(out, b + j * item_size, (b_count - j) * item_size);
+        out += (b_count - j) * item_size;
+    }
+    *count += (size_t)(out - result) / item_size;
+    return result;
+}
+
+YARAPI void* _yar_merge(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                        const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp)
+{
+    return _yar_set_op(_YAR_MERGE, items_pointer, count, capacity, item_size, a, a_count, b, b_count, cmp);
+}
+
+YARAPI void* _yar_union(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                        const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp)
+{
+    return _yar_set_op(_YAR_UNION, items_pointer, count, capacity, item_size, a, a_count, b, b_count, cmp);
+}
+
+YARAPI void* _yar_intersection(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                               const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp)
+{
+    return _yar_set_op(_YAR_INTERSECTION, items_pointer, count, capacity, item_size, a, a_count, b, b_count, cmp);
+}
+
+YARAPI void* _yar_difference(void** items_pointer, size_t* count, size_t* capacity, size_t item_size,
+                             const void* a, size_t a_count, const void* b, size_t b_count, yar_compare_fn cmp)
+{
+    return _yar_set_op(_YAR_DIFFERENCE, items_pointer, count, capacity, item_size, a, a_count, b, b_count, cmp);
+}
+
+
+YARAPI void _yar_gap_move(void* items, size_t count, size_t capacity, size_t* cursor, size_t item_size, size_t index)
+{
+    char* p = items;
+    size_t gap = capacity - count;
+    if (index > count) index = count;
+    if (index < *cursor) {
+        memmove(&p[item_size * (index + gap)], &p[item_size * index], item_size * (*cursor - index));
+    } else if (index > *cursor) {
+        memmove(&p[item_size * *cursor], &p[item_size * (*cursor + gap)], item_size * (index - *cursor));
+    }
+    *cursor = index;
+}
+
+YARAPI void* _yar_gap_insert(void** items_pointer, size_t* count, size_t* capacity, size_t* cursor, size_t item_size, size_t index, size_t extra)
+{
+    _yar_gap_move(*items_pointer, *count, *capacity, cursor, item_size, index);
+    char* items = *items_pointer;
+    size_t newcount = *count + extra;
+    if (newcount > *capacity) {
+        size_t newcap = _yar_grow_capacity(*capacity, newcount);
+        void* next = _yar_realloc(items, newcap * item_size);
+        if (next == NULL) return NULL;
+        items = next;
+        *items_pointer = next;
+        // Keep the items after the gap at the end of the buffer
+        size_t after = *count - *cursor;
+        memmove(&items[item_size * (newcap - after)], &items[item_size * (*capacity - after)], item_size * after);
+        *capacity = newcap;
+    }
+    void* result = items + (*cursor * item_size);
+    if (extra && result) memset(result, 0, item_size * extra);
+    *cursor += extra;
+    *count = newcount;
+    return result;
+}
+
+YARAPI void _yar_gap_remove(void* items, size_t* count, size_t capacity, size_t* cursor, size_t item_size, size_t index, size_t remove)
+{
+    _yar_gap_move(items, *count, capacity, cursor, item_size, index);
+    // The removed items are just absorbed into the gap
+    if (remove > *count - *cursor) remove = *count - *cursor;
+    *count -= remove;
+}
+
+
+#if defined(__SSE2__)
+#include <emmintrin.h> // Block decode, two values at a time
+#endif
+
+// The differences in a block are split into two lanes: difference k goes in
+// lane k % 2, and the words of the lanes are interleaved. Both words of a pair
+// then hold values at the same bit positions, so SSE2 can unpack two values
+// with one uniform shift. Each lane has a spare trailing word, so the next
+// word can always be read, and there is no branch.
+static uint64_t _yar_unpack(const uint64_t* words, size_t k, size_t bits)
+{
+    size_t pos = (k / 2) * bits;
+    const uint64_t* lane = words + (pos >> 6) * 2 + k % 2;
+    return ((lane[0] >> (pos & 63)) | ((lane[2] << 1) << (63 - (pos & 63)))) & (~(uint64_t)0 >> (64 - bits));
+}
+
+static int _yar_packed_flush(yar_packed* packed)
+{
+    const uint64_t* v = packed->tail;
+    uint64_t min = UINT64_MAX, range = 0;
+    for (size_t i = 1; i < YAR_PACKED_BLOCK; i++) {
+        uint64_t d = v[i] - v[i - 1];
+        min = d < min ? d : min;
+    }
+    for (size_t i = 1; i < YAR_PACKED_BLOCK; i++) {
+        range |= v[i] - v[i - 1] - min;
+    }
+    size_t bits = 0;
+    while (bits < 64 && (range >> bits) != 0) bits++;
+    size_t num_words = bits ? 2 * (bits + 1) : 0;
+
+    size_t offset = packed->words.count;
+    // The words must be zeroed, as the packed bits are OR'd in
+    uint64_t* w = _yar_reserve((void**)&packed->words.items, &packed->words.count, &packed->words.capacity, sizeof(uint64_t), num_words);
+    if (num_words && w == NULL) return 0;
+    yar_packed_block* block = _yar_append((void**)&packed->blocks.items, &packed->blocks.count, &packed->blocks.capacity, sizeof(yar_packed_block));
+    if (block == NULL) return 0;
+    block->first = v[0];
+    block->min_delta = min;
+    block->offset = offset;
+    block->bits = bits;
+
+    for (size_t k = 0; bits && k < YAR_PACKED_BLOCK - 1; k++) {
+        uint64_t x = v[k + 1] - v[k] - min;
+        size_t pos = (k / 2) * bits;
+        size_t shift = pos & 63;
+        uint64_t* lane = w + (pos >> 6) * 2 + k % 2;
+        lane[0] |= x << shift;
+        if (shift + bits > 64) lane[2] |= x >> (64 - shift);
+    }
+    packed->words.count += num_words;
+    packed->tail_count = 0;
+    return 1;
+}
+
+YARAPI int yar_packed_append(yar_packed* packed, uint64_t value)
+{
+    return yar_packed_append_many(packed, &value, 1);
+}
+
+YARAPI int yar_packed_append_many(yar_packed* packed, const uint64_t* data, size_t num)
+{
+    while (num > 0) {
+        size_t n = YAR_PACKED_BLOCK - packed->tail_count;
+        if (n > num) n = num;
+        memcpy(&packed->tail[packed->tail_count], data, n * sizeof(uint64_t));
+        packed->tail_count += n;
+        if (packed->tail_count == YAR_PACKED_BLOCK && !_yar_packed_flush(packed)) {
+            // Leave the values in the tail, so the next append can try again
+            packed->tail_count -= n;
+            return 0;
+        }
+        packed->count += n;
+        data += n;
+        num -= n;
+    }
+    return 1;
+}
+
+YARAPI uint64_t yar_packed_get(const yar_packed* packed, size_t index)
+{
+    size_t b = index / YAR_PACKED_BLOCK;
+    size_t i = index % YAR_PACKED_BLOCK;
+    if (b >= packed->blocks.count) return packed->tail[i];
+
+    const yar_packed_block* block = &packed->blocks.items[b];
+    uint64_t result = block->first + i * block->min_delta;
+    if (block->bits) {
+        const uint64_t* w = packed->words.items + block->offset;
+        for (size_t k = 0; k < i; k++) {
+            result += _yar_unpack(w, k, block->bits);
+        }
+    }
+    return result;
+}
+
+YARAPI size_t yar_packed_decode_block(const yar_packed* packed, size_t block_index, uint64_t* out)
+{
+    if (block_index >= packed->blocks.count) {
+        if (block_index > packed->blocks.count) return 0;
+        memcpy(out, packed->tail, packed->tail_count * sizeof(uint64_t));
+        return packed->tail_count;
+    }
+
+    const yar_packed_block* block = &packed->blocks.items[block_index];
+    const uint64_t* w = packed->words.items + block->offset;
+    size_t bits = block->bits;
+    out[0] = block->first;
+    if (bits == 0) {
+        for (size_t i = 1; i < YAR_PACKED_BLOCK; i++) out[i] = out[i - 1] + block->min_delta;
+        return YAR_PACKED_BLOCK;
+    }
+#if defined(__SSE2__)
+    // Unpack a difference from each lane, then add them to the running sum as a
+    // two-value prefix sum: (a, b) becomes (sum + a, sum + a + b).
+    __m128i mask = _mm_set1_epi64x((long long)(~(uint64_t)0 >> (64 - bits)));
+    __m128i min = _mm_set1_epi64x((long long)block->min_delta);
+    __m128i sum = _mm_set1_epi64x((long long)block->first);
+    for (size_t j = 0; j < YAR_PACKED_BLOCK / 2; j++) {
+        size_t pos = j * bits;
+        const __m128i* pair = (const __m128i*)(w + (pos >> 6) * 2);
+        __m128i low = _mm_srl_epi64(_mm_loadu_si128(pair), _mm_cvtsi32_si128((int)(pos & 63)));
+        __m128i high = _mm_sll_epi64(_mm_slli_epi64(_mm_loadu_si128(pair + 1), 1), _mm_cvtsi32_si128((int)(63 - (pos & 63))));
+        __m128i x = _mm_add_epi64(_mm_and_si128(_mm_or_si128(low, high), mask), min);
+        sum = _mm_add_epi64(sum, _mm_add_epi64(x, _mm_slli_si128(x, 8)));
+        if (j + 1 < YAR_PACKED_BLOCK / 2) {
+            _mm_storeu_si128((__m128i*)(out + 2 * j + 1), sum);
+        } else {
+            _mm_storel_epi64((__m128i*)(out + 2 * j + 1), sum); // The last lane 1 value is padding
+        }
+        sum = _mm_unpackhi_epi64(sum, sum);
+    }
+#else
+    // Both lanes share the shifts, so unpack them together
+    uint64_t mask = ~(uint64_t)0 >> (64 - bits);
+    uint64_t sum = block->first;
+    for (size_t j = 0; j < YAR_PACKED_BLOCK / 2; j++) {
+        size_t pos = j * bits;
+        size_t shift = pos & 63;
+        const uint64_t* pair = w + (pos >> 6) * 2;
+        uint64_t a = ((pair[0] >> shift) | ((pair[2] << 1) << (63 - shift))) & mask;
+        uint64_t b = ((pair[1] >> shift) | ((pair[3] << 1) << (63 - shift))) & mask;
+        out[2 * j + 1] = sum += a + block->min_delta;
+        if (j + 1 < YAR_PACKED_BLOCK / 2) out[2 * j + 2] = sum += b + block->min_delta;
+    }
+#endif
+    return YAR_PACKED_BLOCK;
+}
+
+YARAPI void* _yar_packed_to(const yar_packed* packed, void** items_pointer, size_t* count, size_t* capacity, size_t item_size)
+{
+    // Every value is decoded straight into place, so there is no need to zero
+    uint64_t* result = _yar_grow(items_pointer, count, capacity, item_size, packed->count);
+    if (result == NULL) return NULL;
+    uint64_t* out = result;
+    for (size_t b = 0; b <= packed->blocks.count; b++) {
+        out += yar_packed_decode_block(packed, b, out);
+    }
+    *count += packed->count;
+    return result;
+}
+
+YARAPI void yar_packed_free(yar_packed* packed)
+{
+    yar_free(&packed->words);
+    yar_free(&packed->blocks);
+    packed->tail_count = 0;
+    packed->count = 0;
+}
+
+
+#if defined(__GNUC__) || defined(__clang__)
+YARAPI void* _yar_published_append(yar_publisher* publisher, void** items_pointer, size_t* count, size_t* capacity, size_t item_size)
+{
+    void* result = _yar_published_reserve(publisher, items_pointer, count, capacity, item_size, 1);
+    if (result != NULL) *count += 1;
+    return result;
+}
+
+YARAPI void* _yar_published_append_many(yar_publisher* publisher, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const void* data, size_t extra)
+{
+    void* result = _yar_published_reserve(publisher, items_pointer, count, capacity, item_size, extra);
+    if (result != NULL) {
+        memcpy(result, data, item_size * extra);
+        *count += extra;
+    }
+    return result;
+}
+
+YARAPI void* _yar_published_reserve(yar_publisher* publisher, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra)
+{
+    char* items = *items_pointer;
+    size_t newcount = *count + extra;
+    if (newcount > *capacity) {
+        size_t newcap = _yar_grow_capacity(*capacity, newcount);
+        // Readers may be using the old buffer, so it cannot be realloc'd
+        yar_retired* retired = _yar_append((void**)&publisher->retired.items, &publisher->retired.count, &publisher->retired.capacity, sizeof(yar_retired));
+        if (retired == NULL) return NULL;
+        char* next = _yar_realloc(NULL, newcap * item_size);
+        if (next == NULL) {
+            publisher->retired.count--;
+            return NULL;
+        }
+        if (items != NULL) memcpy(next, items, *count * item_size);
+        retired->pointer = items;
+        retired->epoch = UINT64_MAX;
+        items = next;
+        *items_pointer = next;
+        *capacity = newcap;
+    }
+    void* result = items + (*count * item_size);
+    if (extra && result) memset(result, 0, item_size * extra);
+    return result;
+}
+
+YARAPI int _yar_publish(yar_publisher* publisher, const void* items, size_t count)
+{
+    yar_retired* retired = _yar_append((void**)&publisher->retired.items, &publisher->retired.count, &publisher->retired.capacity, sizeof(yar_retired));
+    if (retired == NULL) return 0;
+    yar_snapshot* snapshot = _yar_realloc(NULL, sizeof(*snapshot));
+    if (snapshot == NULL) {
+        publisher->retired.count--;
+        return 0;
+    }
+    snapshot->items = items;
+    snapshot->count = count;
+
+    retired->pointer = __atomic_exchange_n(&publisher->current, snapshot, __ATOMIC_SEQ_CST);
+    // Readers which start after this increment cannot see anything retired so far
+    uint64_t epoch = __atomic_fetch_add(&publisher->epoch, 1, __ATOMIC_SEQ_CST) + 1;
+    for (size_t i = 0; i < publisher->retired.count; i++) {
+        if (publisher->retired.items[i].epoch == UINT64_MAX) publisher->retired.items[i].epoch = epoch;
+    }
+    retired->epoch = epoch;
+    yar_publisher_reclaim(publisher);
+    return 1;
+}
+
+YARAPI yar_snapshot yar_read_begin(yar_publisher* publisher, yar_reader* reader)
+{
+    yar_snapshot result = {0};
+    __atomic_store_n(&reader->epoch, __atomic_load_n(&publisher->epoch, __ATOMIC_SEQ_CST) + 1, __ATOMIC_SEQ_CST);
+    yar_snapshot* snapshot = __atomic_load_n(&publisher->current, __ATOMIC_SEQ_CST);
+    if (snapshot != NULL) result = *snapshot;
+    return result;
+}
+
+YARAPI void yar_read_end(yar_reader* reader)
+{
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+YARAPI void yar_publisher_reclaim(yar_publisher* publisher)
+{
+    uint64_t oldest = UINT64_MAX;
+    for (size_t i = 0; i < publisher->reader_count; i++) {
+        uint64_t epoch = __atomic_load_n(&publisher->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (epoch != 0 && epoch < oldest) oldest = epoch;
+    }
+    size_t kept = 0;
+    for (size_t i = 0; i < publisher->retired.count; i++) {
+        yar_retired r = publisher->retired.items[i];
+        if (r.epoch < oldest) {
+            _yar_free(r.pointer);
+        } else {
+            publisher->retired.items[kept++] = r;
+        }
+    }
+    publisher->retired.count = kept;
+}
+
+YARAPI void yar_publisher_free(yar_publisher* publisher)
+{
+    for (size_t i = 0; i < publisher->retired.count; i++) {
+        _yar_free(publisher->retired.items[i].pointer);
+    }
+    yar_free(&publisher->retired);
+    _yar_free(publisher->current);
+    publisher->current = NULL;
+}
+#endif // __GNUC__ || __clang__
+
+#ifdef YAR_THREADS
+#include <pthread.h>
+#include <unistd.h> // sysconf
+
+typedef struct {
+    char* items;
+    size_t count;
+    size_t item_size;
+    size_t chunk;           // Items per chunk
+    size_t next;            // Start of the next unclaimed chunk
+    size_t users;           // Pool threads working on this job
+    yar_range_fn fn;
+    void* context;
+} _yar_job;
+
+struct yar_pool {
+    pthread_mutex_t mutex;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    _yar_job* job;
+    size_t generation;
+    int stop;
+    size_t thread_count;
+    pthread_t threads[];
+};
+
+static void _yar_job_run(_yar_job* job)
+{
+    for (;;) {
+        size_t start = __atomic_fetch_add(&job->next, job->chunk, __ATOMIC_RELAXED);
+        if (start >= job->count) break;
+        size_t n = job->count - start < job->chunk ? job->count - start : job->chunk;
+        job->fn(job->items + start * job->item_size, n, job->context);
+    }
+}
+
+static void* _yar_pool_thread(void* arg)
+{
+    yar_pool* pool = arg;
+    size_t seen = 0;
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->stop && (pool->job == NULL || pool->generation == seen)) {
+            pthread_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->stop) break;
+        _yar_job* job = pool->job;
+        seen = pool->generation;
+        job->users++;
+        pthread_mutex_unlock(&pool->mutex);
+        _yar_job_run(job);
+        pthread_mutex_lock(&pool->mutex);
+        if (--job->users == 0) pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+YARAPI yar_pool* yar_pool_create(size_t threads)
+{
+    if (threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        // The calling thread does work too
+        threads = cpus > 1 ? (size_t)cpus - 1 : 1;
+    }
+    yar_pool* pool = _yar_realloc(NULL, sizeof(yar_pool) + threads * sizeof(pthread_t));
+    if (pool == NULL) return NULL;
+    memset(pool, 0, sizeof(yar_pool));
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (; pool->thread_count < threads; pool->thread_count++) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL, _yar_pool_thread, pool) != 0) break;
+    }
+    if (pool->thread_count == 0) {
+        yar_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+YARAPI void yar_pool_destroy(yar_pool* pool)
+{
+    if (pool == NULL) return;
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    _yar_free(pool);
+}
+
+static void _yar_pool_run(yar_pool* pool, _yar_job* job)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = job;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+
+    _yar_job_run(job);
+
+    // The job lives on this stack, so wait for every thread to let go of it
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = NULL;
+    while (job->users > 0) pthread_cond_wait(&pool->done, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+#else
+YARAPI yar_pool* yar_pool_create(size_t threads)
+{
+    (void)threads;
+    return NULL;
+}
+
+YARAPI void yar_pool_destroy(yar_pool* pool)
+{
+    (void)pool;
+}
+#endif // YAR_THREADS
+
+YARAPI void _yar_parallel_for(yar_pool* pool, void* items, size_t count, size_t item_size, yar_range_fn fn, void* context)
+{
+    if (count == 0) return;
+#ifdef YAR_THREADS
+    if (pool != NULL && count * item_size >= YAR_PARALLEL_MIN) {
+        size_t chunk = YAR_PARALLEL_CHUNK / item_size;
+        _yar_job job = { items, count, item_size, chunk ? chunk : 1, 0, 0, fn, context };
+        _yar_pool_run(pool, &job);
+        return;
+    }
+#else
+    (void)pool;
+    (void)item_size;
+#endif
+    fn(items, count, context);
+}
+
+typedef struct {
+    char* base;             // Start of the whole destination range
+    const char* source;     // Source for copies, or a single item for fills
+    size_t item_size;
+} _yar_bulk;
+
+static void _yar_fill_range(void* items, size_t count, void* context)
+{
+    _yar_bulk* bulk = context;
+    char* p = items;
+    size_t size = count * bulk->item_size;
+    // Copy the value once, then keep doubling the filled part
+    size_t filled = bulk->item_size;
+    memcpy(p, bulk->source, filled);
+    while (filled < size) {
+        size_t n = filled < size - filled ? filled : size - filled;
+        memcpy(p + filled, p, n);
+        filled += n;
+    }
+}
+
+static void _yar_zero_range(void* items, size_t count, void* context)
+{
+    _yar_bulk* bulk = context;
+    memset(items, 0, count * bulk->item_size);
+}
+
+static void _yar_copy_range(void* items, size_t count, void* context)
+{
+    _yar_bulk* bulk = context;
+    memcpy(items, bulk->source + ((char*)items - bulk->base), count * bulk->item_size);
+}
+
+YARAPI void _yar_parallel_fill(yar_pool* pool, void* items, size_t count, size_t item_size, const void* value)
+{
+    _yar_bulk bulk = { items, value, item_size };
+    _yar_parallel_for(pool, items, count, item_size, _yar_fill_range, &bulk);
+}
+
+YARAPI void* _yar_parallel_reserve(yar_pool* pool, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, size_t extra)
+{
+    void* result = _yar_grow(items_pointer, count, capacity, item_size, extra);
+    if (result == NULL) return NULL;
+    _yar_bulk bulk = { result, NULL, item_size };
+    _yar_parallel_for(pool, result, extra, item_size, _yar_zero_range, &bulk);
+    return result;
+}
+
+YARAPI void* _yar_parallel_append_many(yar_pool* pool, void** items_pointer, size_t* count, size_t* capacity, size_t item_size, const void* data, size_t extra)
+{
+    // No need to zero space which is about to be overwritten
+    void* result = _yar_grow(items_pointer, count, capacity, item_size, extra);
+    if (result == NULL) return NULL;
+    _yar_bulk bulk = { result, data, item_size };
+    _yar_parallel_for(pool, result, extra, item_size, _yar_copy_range, &bulk);
+    *count += extra;
+    return result;
+}
+
+YARAPI int yar_rope_append(yar_rope* rope, const char* data, size_t size)
+{
+    while (size > 0) {
+        if (rope->spare_count == 0) {
+            // A new chunk is allocated at its full size, and never grows
+            yar_rope_chunk* chunk = _yar_append((void**)&rope->chunks.items, &rope->chunks.count, &rope->chunks.capacity, sizeof(yar_rope_chunk));
+            if (chunk == NULL) return 0;
+            chunk->items = _yar_realloc(NULL, YAR_ROPE_CHUNK);
+            if (chunk->items == NULL) {
+                rope->chunks.count--;
+                return 0;
+            }
+            chunk->capacity = YAR_ROPE_CHUNK;
+            rope->spare = chunk->items;
+            rope->spare_count = YAR_ROPE_CHUNK;
+        }
+        yar_rope_chunk* chunk = &rope->chunks.items[rope->chunks.count - 1];
+        if (chunk->items + chunk->count != rope->spare) {
+            // Something was borrowed since. Carry on in the spare space, with a chunk which doesn't own it.
+            chunk = _yar_append((void**)&rope->chunks.items, &rope->chunks.count, &rope->chunks.capacity, sizeof(yar_rope_chunk));
+            if (chunk == NULL) return 0;
+            chunk->items = rope->spare;
+        }
+        size_t n = rope->spare_count < size ? rope->spare_count : size;
+        memcpy(rope->spare, data, n);
+        chunk->count += n;
+        rope->spare += n;
+        rope->spare_count -= n;
+        rope->count += n;
+        data += n;
+        size -= n;
+    }
+    return 1;
+}
+
+YARAPI int yar_rope_borrow(yar_rope* rope, const char* data, size_t size)
+{
+    if (size == 0) return 1;
+    yar_rope_chunk* chunk = _yar_append((void**)&rope->chunks.items, &rope->chunks.count, &rope->chunks.capacity, sizeof(yar_rope_chunk));
+    if (chunk == NULL) return 0;
+    chunk->items = (char*)data;
+    chunk->count = size;
+    rope->count += size;
+    return 1;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/uio.h> // writev
+#include <limits.h> // IOV_MAX
+#include <errno.h>
+
+// The most chunks one writev call can take
+#if defined(IOV_MAX)
+  #define _YAR_ROPE_IOV IOV_MAX
+#elif defined(UIO_MAXIOV)
+  #define _YAR_ROPE_IOV UIO_MAXIOV
+#else
+  #define _YAR_ROPE_IOV 64
+#endif
+
+YARAPI int yar_rope_write(const yar_rope* rope, int fd)
+{
+    struct iovec iov[_YAR_ROPE_IOV];
+    size_t chunk = 0, offset = 0;
+    while (chunk < rope->chunks.count) {
+        int n = 0;
+        for (size_t i = chunk; i < rope->chunks.count && n < _YAR_ROPE_IOV; i++) {
+            const yar_rope_chunk* c = &rope->chunks.items[i];
+            size_t skip = (i == chunk) ? offset : 0;
+            iov[n].iov_base = c->items + skip;
+            iov[n].iov_len = c->count - skip;
+            n++;
+        }
+        ssize_t written = writev(fd, iov, n);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // Skip whatever was written, which may end part way through a chunk
+        size_t left = (size_t)written;
+        while (chunk < rope->chunks.count && left >= rope->chunks.items[chunk].count - offset) {
+            left -= rope->chunks.items[chunk].count - offset;
+            offset = 0;
+            chunk++;
+        }
+        offset += left;
+    }
+    return 0;
+}
+#endif // __unix__ || __APPLE__
+
+YARAPI void* _yar_rope_flatten(const yar_rope* rope, void** items_pointer, size_t* count, size_t* capacity, size_t item_size)
+{
+    char* result = _yar_grow(items_pointer, count, capacity, item_size, rope->count);
+    if (result == NULL) return NULL;
+    char* out = result;
+    for (size_t i = 0; i < rope->chunks.count; i++) {
+        memcpy(out, rope->chunks.items[i].items, rope->chunks.items[i].count);
+        out += rope->chunks.items[i].count;
+    }
+    *count += rope->count;
+    return result;
+}
+
+YARAPI void yar_rope_free(yar_rope* rope)
+{
+    for (size_t i = 0; i < rope->chunks.count; i++) {
+        // Only chunks with a capacity own their memory
+        if (rope->chunks.items[i].capacity) _yar_free(rope->chunks.items[i].items);
+    }
+    yar_free(&rope->chunks);
+    rope->count = 0;
+    rope->spare = NULL;
+    rope->spare_count = 0;
+}
+
 #endif // YAR_IMPLEMENTATION
 /*
 ------------------------------------------------------------------------------